@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS += binarycopy \
+           latency \
+           sendalloc \
+           stress
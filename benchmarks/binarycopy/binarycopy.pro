@@ -0,0 +1,5 @@
+TARGET = binarycopy
+
+include(../common/common.pri)
+
+SOURCES += main.cpp
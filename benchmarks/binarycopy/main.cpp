@@ -0,0 +1,237 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+// Measures how many bytes get copied on the way from the network to a QML
+// onBinaryMessageReceived handler, with QtWebSockets' own WebSocket, which
+// does everything on the GUI thread ("baseline"), and with the threaded one
+// ("zerocopy"), and prints a JSON report per mode.
+//
+// Every heap block at least half the size of the payload is counted as a copy
+// of the message, separately for the GUI thread and for the other threads of
+// the client (where QWebSocketThreaded assembles frames). The local server
+// pushes the messages and the client sends nothing, so only the receive path
+// is counted, and the server's thread is left out. Only glibc allows to
+// interpose the allocator like this.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QUrl>
+
+#include "benchmarkserver.h"
+#include "qmlwebsocketsthreaded_plugin.h"
+
+#include <atomic>
+
+#if defined(__GLIBC__)
+#include <pthread.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static std::atomic<bool> g_counting(false);
+static std::atomic<size_t> g_threshold(0);
+static std::atomic<qint64> g_guiBytes(0);
+static std::atomic<qint64> g_networkBytes(0);
+static pthread_t g_guiThread;
+static pthread_t g_serverThread;
+
+static void countAllocation(size_t size)
+{
+    if (!g_counting.load(std::memory_order_relaxed) || size < g_threshold.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const pthread_t self = pthread_self();
+    if (pthread_equal(self, g_guiThread)) {
+        g_guiBytes += qint64(size);
+    } else if (!pthread_equal(self, g_serverThread)) {
+        g_networkBytes += qint64(size);
+    }
+}
+
+extern "C" void *malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+// Both WebSocket types have the same properties, signals and methods, so the
+// whole exchange runs in QML
+static const char *component =
+        "WebSocket {\n"
+        "    property int count: 0\n"
+        "    property int received: 0\n"
+        "    signal done()\n"
+        "    onStatusChanged: {\n"
+        "        if (status === WebSocket.Error) {\n"
+        "            console.warn(errorString)\n"
+        "            Qt.exit(1)\n"
+        "        }\n"
+        "    }\n"
+        "    onBinaryMessageReceived: {\n"
+        "        var bytes = new Uint8Array(message)\n"
+        "        if (bytes.length > 0 && bytes[bytes.length - 1] === 0x78)\n"
+        "            received++\n"
+        "        if (received === count)\n"
+        "            done()\n"
+        "    }\n"
+        "}\n";
+
+struct BinaryCopyScenario
+{
+    QUrl url;
+    int size;
+    int count;
+    bool threaded;
+};
+
+static QJsonObject run(const BinaryCopyScenario &scenario)
+{
+    QJsonObject report;
+    report.insert(QStringLiteral("mode"), scenario.threaded ? QStringLiteral("zerocopy")
+                                                            : QStringLiteral("baseline"));
+    report.insert(QStringLiteral("size"), scenario.size);
+
+    QQmlEngine engine;
+    QObject::connect(&engine, &QQmlEngine::exit, QCoreApplication::instance(), &QCoreApplication::exit);
+    QQmlComponent qmlComponent(&engine);
+    const QByteArray import = scenario.threaded ? QByteArrayLiteral("import QtWebSocketsThreaded 1.2\n")
+                                                : QByteArrayLiteral("import QtWebSockets 1.1\n");
+    qmlComponent.setData(import + component, QUrl());
+    QScopedPointer<QObject> object(qmlComponent.create());
+    if (!object) {
+        qWarning("%s", qPrintable(qmlComponent.errorString()));
+        report.insert(QStringLiteral("failed"), true);
+        return report;
+    }
+    QObject::connect(object.data(), SIGNAL(done()), QCoreApplication::instance(), SLOT(quit()));
+
+    object->setProperty("count", scenario.count);
+    object->setProperty("url", scenario.url);
+
+#if defined(__GLIBC__)
+    g_guiBytes = 0;
+    g_networkBytes = 0;
+    g_threshold = size_t(scenario.size) / 2;
+    // The handshake doesn't allocate anything near the payload size
+    g_counting = true;
+#endif
+    object->setProperty("active", true);
+    const int result = QCoreApplication::exec();
+#if defined(__GLIBC__)
+    g_counting = false;
+#endif
+
+    const int received = object->property("received").toInt();
+    report.insert(QStringLiteral("messages"), received);
+    report.insert(QStringLiteral("failed"), result != 0 || received < scenario.count);
+#if defined(__GLIBC__)
+    if (received > 0) {
+        report.insert(QStringLiteral("guiBytesCopiedPerMessage"), double(g_guiBytes.load()) / received);
+        report.insert(QStringLiteral("otherBytesCopiedPerMessage"), double(g_networkBytes.load()) / received);
+        report.insert(QStringLiteral("guiCopiesPerMessage"), double(g_guiBytes.load()) / received / scenario.size);
+    }
+#endif
+    return report;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringLiteral("size"),
+                                        QStringLiteral("Payload size in bytes."),
+                                        QStringLiteral("bytes"), QStringLiteral("4194304")));
+    parser.addOption(QCommandLineOption(QStringLiteral("count"),
+                                        QStringLiteral("Number of messages."),
+                                        QStringLiteral("count"), QStringLiteral("50")));
+    parser.addOption(QCommandLineOption(QStringLiteral("mode"),
+                                        QStringLiteral("baseline, zerocopy or both."),
+                                        QStringLiteral("mode"), QStringLiteral("both")));
+    parser.process(app);
+
+    BinaryCopyScenario scenario;
+    scenario.size = qMax(1, parser.value(QStringLiteral("size")).toInt());
+    scenario.count = qMax(1, parser.value(QStringLiteral("count")).toInt());
+
+    const QString mode = parser.value(QStringLiteral("mode"));
+    if (mode != QLatin1String("baseline") && mode != QLatin1String("zerocopy") && mode != QLatin1String("both")) {
+        qWarning("Unknown --mode %s", qPrintable(mode));
+        return 1;
+    }
+
+    QtWebSocketsThreadedDeclarativeModule module;
+    module.registerTypes("QtWebSocketsThreaded");
+
+    BenchmarkServer server;
+    server.setPush(scenario.count, scenario.size);
+    scenario.url = server.start();
+    if (scenario.url.isEmpty()) {
+        qWarning("Unable to start the local server");
+        return 1;
+    }
+#if defined(__GLIBC__)
+    g_guiThread = pthread_self();
+    g_serverThread = pthread_t(server.threadId());
+#endif
+
+    QJsonArray reports;
+    if (mode != QLatin1String("zerocopy")) {
+        scenario.threaded = false;
+        reports.append(run(scenario));
+    }
+    if (mode != QLatin1String("baseline")) {
+        scenario.threaded = true;
+        reports.append(run(scenario));
+    }
+    QTextStream(stdout) << QJsonDocument(reports).toJson(QJsonDocument::Compact) << '\n';
+    return 0;
+}
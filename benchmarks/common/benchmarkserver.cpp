@@ -0,0 +1,139 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "benchmarkserver.h"
+
+#include <QtWebSockets/QWebSocket>
+#include <QtWebSockets/QWebSocketServer>
+#include <QHostAddress>
+
+QT_BEGIN_NAMESPACE
+
+BenchmarkServerWorker::BenchmarkServerWorker()
+    : QObject(),
+      m_echo(true),
+      m_pushCount(0),
+      m_pushSize(0),
+      m_threadId(Q_NULLPTR),
+      m_server(new QWebSocketServer(QStringLiteral("benchmark"), QWebSocketServer::NonSecureMode, this))
+{
+    connect(m_server, &QWebSocketServer::newConnection, this, &BenchmarkServerWorker::onNewConnection);
+}
+
+int BenchmarkServerWorker::listen()
+{
+    m_threadId = QThread::currentThreadId();
+    if (!m_server->listen(QHostAddress::LocalHost)) {
+        return 0;
+    }
+    return m_server->serverPort();
+}
+
+void BenchmarkServerWorker::shutdown()
+{
+    m_server->close();
+}
+
+void BenchmarkServerWorker::onNewConnection()
+{
+    while (QWebSocket *socket = m_server->nextPendingConnection()) {
+        socket->setParent(this);
+        connect(socket, &QWebSocket::disconnected, socket, &QObject::deleteLater);
+        if (m_pushCount > 0) {
+            const QByteArray payload(m_pushSize, 'x');
+            for (int i = 0; i < m_pushCount; ++i) {
+                socket->sendBinaryMessage(payload);
+            }
+            continue;
+        }
+        if (!m_echo) {
+            continue;
+        }
+        connect(socket, &QWebSocket::textMessageReceived, socket, [socket](const QString &message) {
+            socket->sendTextMessage(message);
+        });
+        connect(socket, &QWebSocket::binaryMessageReceived, socket, [socket](const QByteArray &message) {
+            socket->sendBinaryMessage(message);
+        });
+    }
+}
+
+BenchmarkServer::BenchmarkServer(QObject *parent)
+    : QObject(parent),
+      m_worker(new BenchmarkServerWorker)
+{
+    m_thread.setObjectName(QStringLiteral("BenchmarkServer"));
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.start();
+}
+
+BenchmarkServer::~BenchmarkServer()
+{
+    QMetaObject::invokeMethod(m_worker, "shutdown", Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+QUrl BenchmarkServer::start()
+{
+    int port = 0;
+    QMetaObject::invokeMethod(m_worker, "listen", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, port));
+    if (port == 0) {
+        return QUrl();
+    }
+    return QUrl(QStringLiteral("ws://127.0.0.1:%1").arg(port));
+}
+
+void BenchmarkServer::setEcho(bool echo)
+{
+    // The blocking call in start() publishes it to the server thread
+    m_worker->m_echo = echo;
+}
+
+void BenchmarkServer::setPush(int count, int size)
+{
+    m_worker->m_pushCount = count;
+    m_worker->m_pushSize = size;
+}
+
+Qt::HANDLE BenchmarkServer::threadId() const
+{
+    return m_worker->m_threadId;
+}
+
+QT_END_NAMESPACE
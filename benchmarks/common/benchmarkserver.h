@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef BENCHMARKSERVER_H
+#define BENCHMARKSERVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QUrl>
+
+QT_BEGIN_NAMESPACE
+
+class QWebSocket;
+class QWebSocketServer;
+
+class BenchmarkServerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    BenchmarkServerWorker();
+
+    // Set before listening
+    bool m_echo;
+    int m_pushCount;
+    int m_pushSize;
+    Qt::HANDLE m_threadId;
+
+public Q_SLOTS:
+    int listen();
+    void shutdown();
+
+private Q_SLOTS:
+    void onNewConnection();
+
+private:
+    QWebSocketServer *m_server;
+};
+
+// Local echo server running in its own thread, so that a busy GUI thread of
+// the benchmark doesn't slow down the other side of the connection.
+class BenchmarkServer : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(BenchmarkServer)
+
+public:
+    explicit BenchmarkServer(QObject *parent = Q_NULLPTR);
+    ~BenchmarkServer();
+
+    // Starts listening on a free localhost port, returns the ws:// url
+    QUrl start();
+
+    // The server only reads the messages when disabled, to be set before
+    // start(). Enabled by default.
+    void setEcho(bool echo);
+    // Sends count binary messages of size bytes to every client as soon as
+    // it connects, instead of echoing, to be set before start(). 0 by
+    // default.
+    void setPush(int count, int size);
+    // Thread the server runs in, valid after start(), to tell its allocations
+    // apart from the client ones
+    Qt::HANDLE threadId() const;
+
+private:
+    QThread m_thread;
+    BenchmarkServerWorker *m_worker;
+};
+
+QT_END_NAMESPACE
+
+#endif // BENCHMARKSERVER_H
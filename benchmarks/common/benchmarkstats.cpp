@@ -0,0 +1,141 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "benchmarkstats.h"
+
+#include <QFile>
+#include <QJsonArray>
+
+#include <algorithm>
+#include <ctime>
+#if defined(Q_OS_UNIX)
+#include <time.h>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+qint64 processCpuTime()
+{
+    return qint64(std::clock()) * 1000000000 / CLOCKS_PER_SEC;
+}
+
+qint64 threadCpuTime()
+{
+#if defined(Q_OS_UNIX)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+#endif
+    return -1;
+}
+
+// The first number of a line of /proc/self/status
+static qint64 procStatusValue(const QByteArray &key)
+{
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    // readAll() as the file reports a size of 0
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith(key)) {
+            const QList<QByteArray> fields = line.mid(key.size()).simplified().split(' ');
+            bool ok = false;
+            const qint64 value = fields.value(0).toLongLong(&ok);
+            return ok ? value : -1;
+        }
+    }
+    return -1;
+}
+
+int processThreadCount()
+{
+    return int(procStatusValue(QByteArrayLiteral("Threads:")));
+}
+
+qint64 residentSetSize()
+{
+    const qint64 kiB = procStatusValue(QByteArrayLiteral("VmRSS:"));
+    return kiB < 0 ? -1 : kiB * 1024;
+}
+
+QJsonObject summarize(QVector<qint64> values)
+{
+    QJsonObject summary;
+    summary.insert(QStringLiteral("samples"), values.size());
+    if (values.isEmpty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    const auto percentile = [&values](double p) {
+        const int index = qMin(values.size() - 1, int(p * values.size()));
+        return values.at(index) / 1000.0;
+    };
+    summary.insert(QStringLiteral("p50"), percentile(0.5));
+    summary.insert(QStringLiteral("p90"), percentile(0.9));
+    summary.insert(QStringLiteral("p99"), percentile(0.99));
+    summary.insert(QStringLiteral("p999"), percentile(0.999));
+    summary.insert(QStringLiteral("max"), values.last() / 1000.0);
+
+    // Power of two buckets, every bucket counts the values up to its bound
+    QVector<int> buckets;
+    for (qint64 value : qAsConst(values)) {
+        int bucket = 0;
+        for (qint64 us = value / 1000; us > 0; us >>= 1) {
+            ++bucket;
+        }
+        if (bucket >= buckets.size()) {
+            buckets.resize(bucket + 1);
+        }
+        ++buckets[bucket];
+    }
+    QJsonArray histogram;
+    for (int bucket = 0; bucket < buckets.size(); ++bucket) {
+        if (buckets.at(bucket) == 0) {
+            continue;
+        }
+        QJsonObject entry;
+        entry.insert(QStringLiteral("upToUs"), double(qint64(1) << bucket));
+        entry.insert(QStringLiteral("count"), buckets.at(bucket));
+        histogram.append(entry);
+    }
+    summary.insert(QStringLiteral("histogram"), histogram);
+    return summary;
+}
+
+QT_END_NAMESPACE
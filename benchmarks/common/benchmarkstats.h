@@ -0,0 +1,62 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef BENCHMARKSTATS_H
+#define BENCHMARKSTATS_H
+
+#include <QJsonObject>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+// CPU time of the whole process, in ns
+qint64 processCpuTime();
+// CPU time of the calling thread, in ns, -1 where not supported
+qint64 threadCpuTime();
+
+// Threads of the process, -1 where not supported (Linux only)
+int processThreadCount();
+// Resident set size of the process, in bytes, -1 where not supported (Linux
+// only)
+qint64 residentSetSize();
+
+// Takes nanoseconds, reports the percentiles and a power of two histogram in
+// microseconds
+QJsonObject summarize(QVector<qint64> values);
+
+QT_END_NAMESPACE
+
+#endif // BENCHMARKSTATS_H
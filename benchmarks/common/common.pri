@@ -0,0 +1,14 @@
+include($$PWD/../../qmlwebsockets_threaded/qmlwebsockets_threaded.pri)
+
+QT += network
+
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD $$PWD/../../qmlwebsockets_threaded
+
+HEADERS +=  $$PWD/benchmarkserver.h \
+            $$PWD/benchmarkstats.h
+
+SOURCES +=  $$PWD/benchmarkserver.cpp \
+            $$PWD/benchmarkstats.cpp
@@ -0,0 +1,8 @@
+TARGET = latency
+
+include(../common/common.pri)
+
+HEADERS += latencyrun.h
+
+SOURCES += latencyrun.cpp \
+           main.cpp
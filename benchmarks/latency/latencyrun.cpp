@@ -0,0 +1,297 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "latencyrun.h"
+#include "benchmarkstats.h"
+
+#include <QMetaMethod>
+#include <QQmlComponent>
+#include <QQmlEngine>
+
+QT_BEGIN_NAMESPACE
+
+static const char *threadedComponent =
+        "import QtWebSocketsThreaded 1.2\n"
+        "WebSocket {}\n";
+
+// Needs the QtWebSockets QML module to be installed
+static const char *originalComponent =
+        "import QtWebSockets 1.1\n"
+        "WebSocket {}\n";
+
+// The status values are the same for both implementations
+enum { StatusOpen = 1, StatusError = 4 };
+
+static const qint64 stallInterval = 1000000; // 1 ms, in ns
+
+LatencyRun::LatencyRun(const LatencyOptions &options, const QUrl &url, QQmlEngine *engine,
+                       QObject *parent)
+    : QObject(parent),
+      m_options(options),
+      m_url(url),
+      m_engine(engine),
+      m_openClients(0),
+      m_finishedClients(0),
+      m_timedOut(false),
+      m_failed(false),
+      m_lastTick(0),
+      m_startedAt(-1),
+      m_finishedAt(-1),
+      m_cpuStarted(0),
+      m_cpuFinished(0),
+      m_guiCpuStarted(0),
+      m_guiCpuFinished(0),
+      m_bytesReceived(0)
+{
+    if (options.binary) {
+        m_binaryPayload = QByteArray(options.size, 'x');
+    } else {
+        m_textPayload = QString(options.size, QLatin1Char('x'));
+    }
+
+    m_stallTimer.setTimerType(Qt::PreciseTimer);
+    m_stallTimer.setInterval(int(stallInterval / 1000000));
+    connect(&m_stallTimer, &QTimer::timeout, this, &LatencyRun::onStallTick);
+    m_sendTimer.setTimerType(Qt::PreciseTimer);
+    m_sendTimer.setInterval(1);
+    connect(&m_sendTimer, &QTimer::timeout, this, &LatencyRun::onSendTick);
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &LatencyRun::onTimeout);
+}
+
+LatencyRun::~LatencyRun()
+{
+    for (const Client &client : qAsConst(m_clients)) {
+        delete client.socket;
+    }
+}
+
+bool LatencyRun::start(QString *errorString)
+{
+    const bool threaded = m_options.implementation == QLatin1String("threaded");
+    QQmlComponent component(m_engine);
+    component.setData(threaded ? threadedComponent : originalComponent, QUrl());
+
+    const QMetaMethod statusSlot = staticMetaObject.method(
+                staticMetaObject.indexOfSlot("onStatusChanged()"));
+    const QMetaMethod receivedSlot = staticMetaObject.method(
+                staticMetaObject.indexOfSlot("onMessageReceived()"));
+
+    m_clients.reserve(m_options.concurrency);
+    for (int i = 0; i < m_options.concurrency; ++i) {
+        QObject *socket = component.create();
+        if (!socket) {
+            *errorString = component.errorString();
+            return false;
+        }
+        if (threaded && m_options.ringTransport) {
+            socket->setProperty("transport", 1);
+        }
+
+        // Both implementations are driven through the meta-object only, so
+        // the original one doesn't have to be linked
+        const QMetaObject *metaObject = socket->metaObject();
+        const QMetaMethod statusChanged =
+                metaObject->property(metaObject->indexOfProperty("status")).notifySignal();
+        const QMetaMethod received = metaObject->method(metaObject->indexOfSignal(
+                m_options.binary ? "binaryMessageReceived(QByteArray)"
+                                 : "textMessageReceived(QString)"));
+        connect(socket, statusChanged, this, statusSlot);
+        connect(socket, received, this, receivedSlot);
+
+        Client client;
+        client.socket = socket;
+        client.sent = 0;
+        client.received = 0;
+        m_clientIndex.insert(socket, m_clients.size());
+        m_clients.append(client);
+    }
+    for (const Client &client : qAsConst(m_clients)) {
+        client.socket->setProperty("url", m_url);
+        client.socket->setProperty("active", true);
+    }
+    m_timeoutTimer.start(m_options.timeout * 1000);
+    return true;
+}
+
+void LatencyRun::onStatusChanged()
+{
+    if (m_finishedAt >= 0) {
+        return;
+    }
+    const int status = sender()->property("status").toInt();
+    if (status == StatusError) {
+        qWarning("%s", qPrintable(sender()->property("errorString").toString()));
+        m_failed = true;
+        finish();
+    } else if (status == StatusOpen && ++m_openClients == m_clients.size()) {
+        begin();
+    }
+}
+
+void LatencyRun::onMessageReceived()
+{
+    if (m_startedAt < 0 || m_finishedAt >= 0) {
+        return;
+    }
+    Client &client = m_clients[m_clientIndex.value(sender())];
+    if (client.sentAt.isEmpty()) {
+        return;
+    }
+    // The echo server keeps the order, so the oldest message is the one that
+    // came back
+    m_latencies.append(m_clock.nsecsElapsed() - client.sentAt.dequeue());
+    m_bytesReceived += m_options.size;
+    if (++client.received == m_options.count) {
+        if (++m_finishedClients == m_clients.size()) {
+            finish();
+        }
+        return;
+    }
+    if (m_options.rate == 0 && client.sent < m_options.count) {
+        send(client);
+    }
+}
+
+void LatencyRun::onStallTick()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    m_stalls.append(qMax<qint64>(0, now - m_lastTick - stallInterval));
+    m_lastTick = now;
+}
+
+void LatencyRun::onSendTick()
+{
+    const qint64 elapsed = m_clock.nsecsElapsed();
+    const int due = int(qMin<qint64>(m_options.count, elapsed * m_options.rate / 1000000000 + 1));
+    for (Client &client : m_clients) {
+        while (client.sent < due) {
+            send(client);
+        }
+    }
+}
+
+void LatencyRun::onTimeout()
+{
+    m_timedOut = true;
+    finish();
+}
+
+void LatencyRun::send(Client &client)
+{
+    client.sentAt.enqueue(m_clock.nsecsElapsed());
+    ++client.sent;
+    if (m_options.binary) {
+        QMetaObject::invokeMethod(client.socket, "sendBinaryMessage",
+                                  Q_ARG(QByteArray, m_binaryPayload));
+    } else {
+        QMetaObject::invokeMethod(client.socket, "sendTextMessage",
+                                  Q_ARG(QString, m_textPayload));
+    }
+}
+
+void LatencyRun::begin()
+{
+    m_clock.start();
+    m_startedAt = 0;
+    m_lastTick = 0;
+    m_cpuStarted = processCpuTime();
+    m_guiCpuStarted = threadCpuTime();
+    m_stallTimer.start();
+    if (m_options.rate == 0) {
+        for (Client &client : m_clients) {
+            send(client);
+        }
+    } else {
+        onSendTick();
+        m_sendTimer.start();
+    }
+}
+
+void LatencyRun::finish()
+{
+    if (m_finishedAt >= 0) {
+        return;
+    }
+    m_finishedAt = m_startedAt < 0 ? 0 : m_clock.nsecsElapsed();
+    m_cpuFinished = processCpuTime();
+    m_guiCpuFinished = threadCpuTime();
+    m_stallTimer.stop();
+    m_sendTimer.stop();
+    m_timeoutTimer.stop();
+    Q_EMIT finished();
+}
+
+QJsonObject LatencyRun::report() const
+{
+    QJsonObject report;
+    report.insert(QStringLiteral("implementation"), m_options.implementation);
+    if (m_options.implementation == QLatin1String("threaded")) {
+        report.insert(QStringLiteral("transport"), m_options.ringTransport
+                      ? QStringLiteral("ring") : QStringLiteral("signal"));
+    }
+    report.insert(QStringLiteral("size"), m_options.size);
+    report.insert(QStringLiteral("concurrency"), m_options.concurrency);
+    report.insert(QStringLiteral("count"), m_options.count);
+    report.insert(QStringLiteral("rate"), m_options.rate);
+    report.insert(QStringLiteral("binary"), m_options.binary);
+    report.insert(QStringLiteral("failed"), m_failed);
+    report.insert(QStringLiteral("timedOut"), m_timedOut);
+
+    const int messages = m_latencies.size();
+    const double seconds = m_finishedAt / 1e9;
+    report.insert(QStringLiteral("messages"), messages);
+    report.insert(QStringLiteral("durationMs"), m_finishedAt / 1e6);
+    if (seconds > 0) {
+        report.insert(QStringLiteral("messagesPerSecond"), messages / seconds);
+        report.insert(QStringLiteral("bytesPerSecond"), m_bytesReceived / seconds);
+    }
+    if (messages > 0) {
+        // The echo server runs in this process too, so the process time
+        // includes its share
+        report.insert(QStringLiteral("cpuUsPerMessage"),
+                      (m_cpuFinished - m_cpuStarted) / 1e3 / messages);
+        if (m_guiCpuStarted >= 0) {
+            report.insert(QStringLiteral("guiCpuUsPerMessage"),
+                          (m_guiCpuFinished - m_guiCpuStarted) / 1e3 / messages);
+        }
+    }
+    report.insert(QStringLiteral("latencyUs"), summarize(m_latencies));
+    report.insert(QStringLiteral("stallUs"), summarize(m_stalls));
+    return report;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,135 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef LATENCYRUN_H
+#define LATENCYRUN_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QQueue>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QQmlEngine;
+
+struct LatencyOptions
+{
+    QString implementation;
+    int size;
+    int concurrency;
+    int count;
+    int rate;
+    bool binary;
+    bool ringTransport;
+    int timeout;
+};
+
+// One scenario against one WebSocket implementation: opens the sockets, sends
+// the messages, measures the echoes and the GUI thread stalls.
+class LatencyRun : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(LatencyRun)
+
+public:
+    LatencyRun(const LatencyOptions &options, const QUrl &url, QQmlEngine *engine,
+               QObject *parent = Q_NULLPTR);
+    ~LatencyRun();
+
+    // Creates the sockets, returns false if the QML module is not available
+    bool start(QString *errorString);
+    QJsonObject report() const;
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void onStatusChanged();
+    void onMessageReceived();
+    void onStallTick();
+    void onSendTick();
+    void onTimeout();
+
+private:
+    struct Client
+    {
+        QObject *socket;
+        QQueue<qint64> sentAt;
+        int sent;
+        int received;
+    };
+
+    LatencyOptions m_options;
+    QUrl m_url;
+    QQmlEngine *m_engine;
+    QVector<Client> m_clients;
+    QHash<QObject *, int> m_clientIndex;
+    QString m_textPayload;
+    QByteArray m_binaryPayload;
+
+    QElapsedTimer m_clock;
+    QTimer m_stallTimer;
+    QTimer m_sendTimer;
+    QTimer m_timeoutTimer;
+    int m_openClients;
+    int m_finishedClients;
+    bool m_timedOut;
+    bool m_failed;
+    qint64 m_lastTick;
+    qint64 m_startedAt;
+    qint64 m_finishedAt;
+    qint64 m_cpuStarted;
+    qint64 m_cpuFinished;
+    qint64 m_guiCpuStarted;
+    qint64 m_guiCpuFinished;
+    qint64 m_bytesReceived;
+
+    QVector<qint64> m_stalls;
+    QVector<qint64> m_latencies;
+
+    void send(Client &client);
+    void begin();
+    void finish();
+};
+
+QT_END_NAMESPACE
+
+#endif // LATENCYRUN_H
@@ -0,0 +1,141 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+// Runs the same echo scenario against the original QtWebSockets WebSocket and
+// against the threaded one, and prints a JSON report per implementation:
+// end-to-end latency and GUI event loop stall percentiles and histograms,
+// throughput and CPU time per message.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QQmlEngine>
+#include <QStringList>
+#include <QTextStream>
+
+#include "benchmarkserver.h"
+#include "latencyrun.h"
+#include "qmlwebsocketsthreaded_plugin.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringLiteral("size"),
+                                        QStringLiteral("Message size, in bytes or UTF-16 characters."),
+                                        QStringLiteral("size"), QStringLiteral("131072")));
+    parser.addOption(QCommandLineOption(QStringLiteral("concurrency"),
+                                        QStringLiteral("Number of sockets."),
+                                        QStringLiteral("sockets"), QStringLiteral("5")));
+    parser.addOption(QCommandLineOption(QStringLiteral("count"),
+                                        QStringLiteral("Messages sent by every socket."),
+                                        QStringLiteral("count"), QStringLiteral("100")));
+    parser.addOption(QCommandLineOption(QStringLiteral("rate"),
+                                        QStringLiteral("Messages per second sent by every socket, "
+                                                       "0 sends the next one once the previous echo arrived."),
+                                        QStringLiteral("rate"), QStringLiteral("0")));
+    parser.addOption(QCommandLineOption(QStringLiteral("binary"),
+                                        QStringLiteral("Send binary instead of text messages.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("impl"),
+                                        QStringLiteral("original, threaded or both."),
+                                        QStringLiteral("impl"), QStringLiteral("both")));
+    parser.addOption(QCommandLineOption(QStringLiteral("ring"),
+                                        QStringLiteral("Use the ring transport of the threaded WebSocket.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("timeout"),
+                                        QStringLiteral("Time limit of a run, in seconds."),
+                                        QStringLiteral("seconds"), QStringLiteral("60")));
+    parser.process(app);
+
+    LatencyOptions options;
+    options.size = qMax(1, parser.value(QStringLiteral("size")).toInt());
+    options.concurrency = qMax(1, parser.value(QStringLiteral("concurrency")).toInt());
+    options.count = qMax(1, parser.value(QStringLiteral("count")).toInt());
+    options.rate = qMax(0, parser.value(QStringLiteral("rate")).toInt());
+    options.binary = parser.isSet(QStringLiteral("binary"));
+    options.ringTransport = parser.isSet(QStringLiteral("ring"));
+    options.timeout = qMax(1, parser.value(QStringLiteral("timeout")).toInt());
+
+    const QString impl = parser.value(QStringLiteral("impl"));
+    QStringList implementations;
+    if (impl == QLatin1String("both")) {
+        implementations << QStringLiteral("original") << QStringLiteral("threaded");
+    } else if (impl == QLatin1String("original") || impl == QLatin1String("threaded")) {
+        implementations << impl;
+    } else {
+        qWarning("Unknown implementation: %s", qPrintable(impl));
+        return 1;
+    }
+
+    QtWebSocketsThreadedDeclarativeModule module;
+    module.registerTypes("QtWebSocketsThreaded");
+
+    BenchmarkServer server;
+    const QUrl url = server.start();
+    if (url.isEmpty()) {
+        qWarning("Unable to start the local server");
+        return 1;
+    }
+
+    QQmlEngine engine;
+    QJsonArray reports;
+    int result = 0;
+    for (const QString &implementation : qAsConst(implementations)) {
+        options.implementation = implementation;
+        LatencyRun run(options, url, &engine);
+        QString errorString;
+        if (!run.start(&errorString)) {
+            qWarning("%s: %s", qPrintable(implementation), qPrintable(errorString));
+            result = 1;
+            continue;
+        }
+        QEventLoop loop;
+        QObject::connect(&run, &LatencyRun::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+        const QJsonObject report = run.report();
+        if (report.value(QStringLiteral("failed")).toBool()
+                || report.value(QStringLiteral("timedOut")).toBool()) {
+            result = 1;
+        }
+        reports.append(report);
+    }
+
+    QTextStream(stdout) << QJsonDocument(reports).toJson(QJsonDocument::Indented);
+    return result;
+}
@@ -0,0 +1,262 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+// Counts the heap allocations made per binary message sent, with a freshly
+// allocated QByteArray per message ("copy") and with buffers taken from
+// QWebSocketThreaded::bufferPool() ("pool"), and prints a JSON report per
+// mode.
+//
+// Allocations are counted separately for the GUI thread, where messages are
+// built and posted, and for the other threads of the client: the network
+// thread, where QWebSocket frames and masks them. The local server doesn't
+// echo and its thread is left out. Only glibc allows to interpose the
+// allocator like this.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QUrl>
+
+#include "benchmarkserver.h"
+#include "qwebsocketthreaded.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__GLIBC__)
+#include <pthread.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+
+static std::atomic<bool> g_counting(false);
+static std::atomic<qint64> g_guiAllocations(0);
+static std::atomic<qint64> g_guiBytes(0);
+static std::atomic<qint64> g_networkAllocations(0);
+static std::atomic<qint64> g_networkBytes(0);
+static pthread_t g_guiThread;
+static pthread_t g_serverThread;
+
+static void countAllocation(size_t size)
+{
+    if (!g_counting.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const pthread_t self = pthread_self();
+    if (pthread_equal(self, g_guiThread)) {
+        ++g_guiAllocations;
+        g_guiBytes += qint64(size);
+    } else if (!pthread_equal(self, g_serverThread)) {
+        ++g_networkAllocations;
+        g_networkBytes += qint64(size);
+    }
+}
+
+extern "C" void *malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+#endif
+
+struct SendAllocScenario
+{
+    QUrl url;
+    int size;
+    int count;
+    int window;
+    bool pool;
+    bool ring;
+};
+
+static QJsonObject run(const SendAllocScenario &scenario)
+{
+    QWebSocketThreaded socket;
+    if (scenario.ring) {
+        socket.setTransport(QWebSocketThreaded::RingTransport);
+    }
+    // Enough buffers for a whole window in flight
+    socket.bufferPool()->setMaxCount(scenario.window);
+
+    QEventLoop loop;
+    int sent = 0;
+    int counted = 0;
+    bool failed = false;
+
+    const auto sendWindow = [&]() {
+        // The first window fills the pool and isn't counted
+        if (sent >= scenario.window) {
+            counted += qMin(scenario.window, scenario.count - sent);
+#if defined(__GLIBC__)
+            g_counting = true;
+#endif
+        }
+        for (int i = 0; i < scenario.window && sent < scenario.count; ++i, ++sent) {
+            if (scenario.pool) {
+                QWebSocketThreadedBuffer buffer = socket.bufferPool()->acquire(scenario.size);
+                memset(buffer.data(), 'x', size_t(scenario.size));
+                socket.postBinaryBuffer(buffer);
+            } else {
+                QByteArray payload(scenario.size, Qt::Uninitialized);
+                memset(payload.data(), 'x', size_t(scenario.size));
+                socket.postBinaryMessage(payload);
+            }
+        }
+    };
+
+    QObject::connect(&socket, &QWebSocketThreaded::connected, sendWindow);
+    QObject::connect(&socket, &QWebSocketThreaded::drained, [&]() {
+        if (sent < scenario.count) {
+            sendWindow();
+        } else {
+            loop.quit();
+        }
+    });
+    QObject::connect(&socket, static_cast<void (QWebSocketThreaded::*)(QAbstractSocket::SocketError)>(&QWebSocketThreaded::error),
+                     [&]() {
+        qWarning("%s", qPrintable(socket.errorString()));
+        failed = true;
+        loop.quit();
+    });
+
+#if defined(__GLIBC__)
+    g_guiAllocations = 0;
+    g_guiBytes = 0;
+    g_networkAllocations = 0;
+    g_networkBytes = 0;
+#endif
+    socket.open(scenario.url);
+    loop.exec();
+#if defined(__GLIBC__)
+    g_counting = false;
+#endif
+    socket.close();
+
+    QJsonObject report;
+    report.insert(QStringLiteral("mode"), scenario.pool ? QStringLiteral("pool") : QStringLiteral("copy"));
+    report.insert(QStringLiteral("transport"), scenario.ring ? QStringLiteral("ring") : QStringLiteral("signal"));
+    report.insert(QStringLiteral("size"), scenario.size);
+    report.insert(QStringLiteral("messages"), counted);
+    report.insert(QStringLiteral("failed"), failed);
+    report.insert(QStringLiteral("poolAllocations"), double(socket.bufferPool()->allocations()));
+#if defined(__GLIBC__)
+    if (counted > 0) {
+        report.insert(QStringLiteral("guiAllocationsPerSend"), double(g_guiAllocations) / counted);
+        report.insert(QStringLiteral("guiBytesPerSend"), double(g_guiBytes) / counted);
+        report.insert(QStringLiteral("networkAllocationsPerSend"), double(g_networkAllocations) / counted);
+        report.insert(QStringLiteral("networkBytesPerSend"), double(g_networkBytes) / counted);
+    }
+#endif
+    return report;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringLiteral("size"),
+                                        QStringLiteral("Payload size in bytes."),
+                                        QStringLiteral("bytes"), QStringLiteral("16384")));
+    parser.addOption(QCommandLineOption(QStringLiteral("count"),
+                                        QStringLiteral("Number of messages."),
+                                        QStringLiteral("count"), QStringLiteral("10000")));
+    parser.addOption(QCommandLineOption(QStringLiteral("window"),
+                                        QStringLiteral("Messages sent before waiting for the socket to drain."),
+                                        QStringLiteral("count"), QStringLiteral("64")));
+    parser.addOption(QCommandLineOption(QStringLiteral("mode"),
+                                        QStringLiteral("copy, pool or both."),
+                                        QStringLiteral("mode"), QStringLiteral("both")));
+    parser.addOption(QCommandLineOption(QStringLiteral("ring"),
+                                        QStringLiteral("Use the ring transport.")));
+    parser.process(app);
+
+    SendAllocScenario scenario;
+    scenario.size = qMax(1, parser.value(QStringLiteral("size")).toInt());
+    scenario.window = qMax(1, parser.value(QStringLiteral("window")).toInt());
+    scenario.count = qMax(scenario.window + 1, parser.value(QStringLiteral("count")).toInt());
+    scenario.ring = parser.isSet(QStringLiteral("ring"));
+
+    const QString mode = parser.value(QStringLiteral("mode"));
+    if (mode != QLatin1String("copy") && mode != QLatin1String("pool") && mode != QLatin1String("both")) {
+        qWarning("Unknown --mode %s", qPrintable(mode));
+        return 1;
+    }
+
+    BenchmarkServer server;
+    server.setEcho(false);
+    scenario.url = server.start();
+    if (scenario.url.isEmpty()) {
+        qWarning("Unable to start the local server");
+        return 1;
+    }
+#if defined(__GLIBC__)
+    g_guiThread = pthread_self();
+    g_serverThread = pthread_t(server.threadId());
+#endif
+
+    QJsonArray reports;
+    if (mode != QLatin1String("pool")) {
+        scenario.pool = false;
+        reports.append(run(scenario));
+    }
+    if (mode != QLatin1String("copy")) {
+        scenario.pool = true;
+        reports.append(run(scenario));
+    }
+    QTextStream(stdout) << QJsonDocument(reports).toJson(QJsonDocument::Compact) << endl;
+    return 0;
+}
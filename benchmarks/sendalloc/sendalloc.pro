@@ -0,0 +1,5 @@
+TARGET = sendalloc
+
+include(../common/common.pri)
+
+SOURCES += main.cpp
@@ -0,0 +1,190 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+// Opens an increasing number of threaded sockets against a local echo server,
+// has every socket send at a fixed rate, and prints a JSON report per socket
+// count and threading: network and process threads, resident memory, CPU time
+// per message, throughput per CPU second, GUI thread stalls and latency.
+// "dedicated" gives every socket its own network thread, as before the
+// thread pool, "pool" shares the threads of a QWebSocketThreadPool. With
+// --coalesce the sockets coalesce their sends, and the socket write calls of
+// the clients are counted to see how many messages every write carries.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QTextStream>
+
+#include "benchmarkserver.h"
+#include "socketwrites.h"
+#include "stressrun.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+// Every connection takes two descriptors, the client and the server end
+static void raiseFileLimit()
+{
+#if defined(Q_OS_UNIX)
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringLiteral("sockets"),
+                                        QStringLiteral("Comma separated socket counts, one run each."),
+                                        QStringLiteral("counts"), QStringLiteral("1,10,100,1000")));
+    parser.addOption(QCommandLineOption(QStringLiteral("threading"),
+                                        QStringLiteral("pool, dedicated or both."),
+                                        QStringLiteral("threading"), QStringLiteral("both")));
+    parser.addOption(QCommandLineOption(QStringLiteral("pool-threads"),
+                                        QStringLiteral("Threads of the pool, 0 for one per core."),
+                                        QStringLiteral("threads"), QStringLiteral("0")));
+    parser.addOption(QCommandLineOption(QStringLiteral("size"),
+                                        QStringLiteral("Message size, in bytes or UTF-16 characters."),
+                                        QStringLiteral("size"), QStringLiteral("1024")));
+    parser.addOption(QCommandLineOption(QStringLiteral("rate"),
+                                        QStringLiteral("Messages per second sent by every socket."),
+                                        QStringLiteral("rate"), QStringLiteral("10")));
+    parser.addOption(QCommandLineOption(QStringLiteral("duration"),
+                                        QStringLiteral("Time every socket spends sending, in seconds."),
+                                        QStringLiteral("seconds"), QStringLiteral("5")));
+    parser.addOption(QCommandLineOption(QStringLiteral("binary"),
+                                        QStringLiteral("Send binary instead of text messages.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("batch"),
+                                        QStringLiteral("Receive the echoes with messagesReceived().")));
+    parser.addOption(QCommandLineOption(QStringLiteral("ring"),
+                                        QStringLiteral("Use the ring transport.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("coalesce"),
+                                        QStringLiteral("Coalesce the sends of every socket.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("coalesce-delay"),
+                                        QStringLiteral("Time sends are held for with --coalesce, in milliseconds."),
+                                        QStringLiteral("ms"), QStringLiteral("0")));
+    parser.addOption(QCommandLineOption(QStringLiteral("timeout"),
+                                        QStringLiteral("Time limit of a run, in seconds."),
+                                        QStringLiteral("seconds"), QStringLiteral("120")));
+    parser.process(app);
+
+    StressOptions options;
+    options.poolThreads = qMax(0, parser.value(QStringLiteral("pool-threads")).toInt());
+    options.size = qMax(1, parser.value(QStringLiteral("size")).toInt());
+    options.rate = qMax(1, parser.value(QStringLiteral("rate")).toInt());
+    options.duration = qMax(1, parser.value(QStringLiteral("duration")).toInt());
+    options.binary = parser.isSet(QStringLiteral("binary"));
+    options.batch = parser.isSet(QStringLiteral("batch"));
+    options.ringTransport = parser.isSet(QStringLiteral("ring"));
+    options.coalesce = parser.isSet(QStringLiteral("coalesce"));
+    options.coalesceDelay = qMax(0, parser.value(QStringLiteral("coalesce-delay")).toInt());
+    options.timeout = qMax(1, parser.value(QStringLiteral("timeout")).toInt());
+
+    QVector<int> counts;
+    const QStringList values = parser.value(QStringLiteral("sockets"))
+            .split(QLatin1Char(','));
+    for (const QString &value : values) {
+        // Skipped by hand, QString::SkipEmptyParts is deprecated since 5.14
+        if (value.trimmed().isEmpty()) {
+            continue;
+        }
+        bool ok = false;
+        const int count = value.trimmed().toInt(&ok);
+        if (!ok || count < 1) {
+            qWarning("Invalid socket count: %s", qPrintable(value));
+            return 1;
+        }
+        counts.append(count);
+    }
+
+    const QString threading = parser.value(QStringLiteral("threading"));
+    QStringList threadings;
+    if (threading == QLatin1String("both")) {
+        threadings << QStringLiteral("pool") << QStringLiteral("dedicated");
+    } else if (threading == QLatin1String("pool") || threading == QLatin1String("dedicated")) {
+        threadings << threading;
+    } else {
+        qWarning("Unknown threading: %s", qPrintable(threading));
+        return 1;
+    }
+
+    raiseFileLimit();
+
+    BenchmarkServer server;
+    const QUrl url = server.start();
+    if (url.isEmpty()) {
+        qWarning("Unable to start the local server");
+        return 1;
+    }
+    setSocketWritesExcludedThread(server.threadId());
+    setSocketWritesCounting(true);
+
+    QJsonArray reports;
+    int result = 0;
+    for (int count : qAsConst(counts)) {
+        for (const QString &mode : qAsConst(threadings)) {
+            options.threading = mode;
+            options.sockets = count;
+            QJsonObject report;
+            {
+                StressRun run(options, url);
+                QEventLoop loop;
+                QObject::connect(&run, &StressRun::finished, &loop, &QEventLoop::quit);
+                run.start();
+                loop.exec();
+                report = run.report();
+            }
+            if (report.value(QStringLiteral("failed")).toBool()
+                    || report.value(QStringLiteral("timedOut")).toBool()) {
+                result = 1;
+            }
+            reports.append(report);
+        }
+    }
+
+    QTextStream(stdout) << QJsonDocument(reports).toJson(QJsonDocument::Indented);
+    return result;
+}
@@ -0,0 +1,171 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "socketwrites.h"
+
+#include <atomic>
+
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static std::atomic<bool> g_counting(false);
+static std::atomic<qint64> g_calls(0);
+static std::atomic<qint64> g_bytes(0);
+static pthread_t g_excludedThread;
+static std::atomic<bool> g_hasExcludedThread(false);
+
+// Threads also write to the eventfd of the dispatcher they wake up, which is
+// not a socket write
+static void countWrite(int fd, ssize_t result)
+{
+    if (!g_counting.load(std::memory_order_relaxed) || result < 0) {
+        return;
+    }
+    if (g_hasExcludedThread.load(std::memory_order_relaxed)
+            && pthread_equal(pthread_self(), g_excludedThread)) {
+        return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISSOCK(status.st_mode)) {
+        return;
+    }
+    ++g_calls;
+    g_bytes += qint64(result);
+}
+
+template <typename Function>
+static Function next(const char *name)
+{
+    return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+extern "C" ssize_t write(int fd, const void *buffer, size_t count)
+{
+    static const auto function = next<ssize_t (*)(int, const void *, size_t)>("write");
+    const ssize_t result = function(fd, buffer, count);
+    countWrite(fd, result);
+    return result;
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec *vector, int count)
+{
+    static const auto function = next<ssize_t (*)(int, const struct iovec *, int)>("writev");
+    const ssize_t result = function(fd, vector, count);
+    countWrite(fd, result);
+    return result;
+}
+
+extern "C" ssize_t send(int fd, const void *buffer, size_t length, int flags)
+{
+    static const auto function = next<ssize_t (*)(int, const void *, size_t, int)>("send");
+    const ssize_t result = function(fd, buffer, length, flags);
+    countWrite(fd, result);
+    return result;
+}
+
+extern "C" ssize_t sendto(int fd, const void *buffer, size_t length, int flags,
+                          const struct sockaddr *address, socklen_t addressLength)
+{
+    static const auto function = next<ssize_t (*)(int, const void *, size_t, int,
+                                                  const struct sockaddr *, socklen_t)>("sendto");
+    const ssize_t result = function(fd, buffer, length, flags, address, addressLength);
+    countWrite(fd, result);
+    return result;
+}
+
+extern "C" ssize_t sendmsg(int fd, const struct msghdr *message, int flags)
+{
+    static const auto function = next<ssize_t (*)(int, const struct msghdr *, int)>("sendmsg");
+    const ssize_t result = function(fd, message, flags);
+    countWrite(fd, result);
+    return result;
+}
+#endif
+
+QT_BEGIN_NAMESPACE
+
+bool socketWritesSupported()
+{
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setSocketWritesExcludedThread(Qt::HANDLE threadId)
+{
+#if defined(__GLIBC__)
+    g_excludedThread = pthread_t(threadId);
+    g_hasExcludedThread = true;
+#else
+    Q_UNUSED(threadId)
+#endif
+}
+
+void setSocketWritesCounting(bool counting)
+{
+#if defined(__GLIBC__)
+    g_counting = counting;
+#else
+    Q_UNUSED(counting)
+#endif
+}
+
+qint64 socketWriteCalls()
+{
+#if defined(__GLIBC__)
+    return g_calls.load();
+#else
+    return 0;
+#endif
+}
+
+qint64 socketWriteBytes()
+{
+#if defined(__GLIBC__)
+    return g_bytes.load();
+#else
+    return 0;
+#endif
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,56 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef SOCKETWRITES_H
+#define SOCKETWRITES_H
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+
+// Write calls (write, writev, send, sendto and sendmsg) that reached a socket
+// while counting, from every thread but the excluded one, the echo server's.
+// Only glibc allows to interpose them like this, elsewhere nothing is counted
+// and socketWritesSupported() is false.
+bool socketWritesSupported();
+void setSocketWritesExcludedThread(Qt::HANDLE threadId);
+void setSocketWritesCounting(bool counting);
+qint64 socketWriteCalls();
+qint64 socketWriteBytes();
+
+QT_END_NAMESPACE
+
+#endif // SOCKETWRITES_H
@@ -0,0 +1,13 @@
+TARGET = stress
+
+include(../common/common.pri)
+
+HEADERS += stressrun.h \
+           socketwrites.h
+
+SOURCES += stressrun.cpp \
+           socketwrites.cpp \
+           main.cpp
+
+# dlsym() of the interposed write calls, part of libc itself since glibc 2.34
+linux: LIBS += -ldl
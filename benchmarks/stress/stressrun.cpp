@@ -0,0 +1,414 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "stressrun.h"
+#include "benchmarkstats.h"
+#include "socketwrites.h"
+#include "qwebsocketthreaded.h"
+#include "qwebsocketthreadpool.h"
+
+#include <QEventLoop>
+#include <QThread>
+
+QT_BEGIN_NAMESPACE
+
+static const qint64 stallInterval = 1000000; // 1 ms, in ns
+// Same as the workers give the close handshake
+static const int shutdownTimeout = 5000;
+
+StressRun::StressRun(const StressOptions &options, const QUrl &url, QObject *parent)
+    : QObject(parent),
+      m_options(options),
+      m_url(url),
+      m_count(qMax(1, options.rate * options.duration)),
+      m_openClients(0),
+      m_finishedClients(0),
+      m_timedOut(false),
+      m_failed(false),
+      m_lastTick(0),
+      m_startedAt(-1),
+      m_finishedAt(-1),
+      m_cpuStarted(0),
+      m_cpuFinished(0),
+      m_guiCpuStarted(0),
+      m_guiCpuFinished(0),
+      m_writesStarted(0),
+      m_writesFinished(0),
+      m_writtenStarted(0),
+      m_writtenFinished(0),
+      m_networkThreads(0),
+      m_baselineThreads(-1),
+      m_peakThreads(-1),
+      m_baselineRss(-1),
+      m_peakRss(-1)
+{
+    if (options.binary) {
+        m_binaryPayload = QByteArray(options.size, 'x');
+    } else {
+        m_textPayload = QString(options.size, QLatin1Char('x'));
+    }
+
+    m_stallTimer.setTimerType(Qt::PreciseTimer);
+    m_stallTimer.setInterval(int(stallInterval / 1000000));
+    connect(&m_stallTimer, &QTimer::timeout, this, &StressRun::onStallTick);
+    m_sendTimer.setTimerType(Qt::PreciseTimer);
+    m_sendTimer.setInterval(1);
+    connect(&m_sendTimer, &QTimer::timeout, this, &StressRun::onSendTick);
+    m_sampleTimer.setInterval(100);
+    connect(&m_sampleTimer, &QTimer::timeout, this, &StressRun::onSampleTick);
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &StressRun::onTimeout);
+}
+
+StressRun::~StressRun()
+{
+    // Closed while they still report back, so that their workers are done
+    // with the close handshake when the sockets go
+    {
+        QEventLoop loop;
+        int open = 0;
+        for (const Client &client : qAsConst(m_clients)) {
+            if (client.socket->state() == QAbstractSocket::UnconnectedState) {
+                continue;
+            }
+            ++open;
+            connect(client.socket, &QWebSocketThreaded::stateChanged, &loop,
+                    [&loop, &open](QAbstractSocket::SocketState state) {
+                if (state == QAbstractSocket::UnconnectedState && --open == 0) {
+                    loop.quit();
+                }
+            });
+            client.socket->close();
+        }
+        if (open > 0) {
+            QTimer::singleShot(shutdownTimeout, &loop, &QEventLoop::quit);
+            loop.exec();
+        }
+    }
+    // The disconnected workers delete themselves once their thread ran the
+    // queued shutdown
+    for (const Client &client : qAsConst(m_clients)) {
+        delete client.socket;
+    }
+    // The pool has its threads run the pending shutdowns, and aborts the
+    // workers still closing, before it stops them
+    m_pool.reset();
+    // A dedicated thread is only quit once it deleted an object queued after
+    // the shutdown, the deleteLater() of its worker is then flushed when the
+    // thread finishes
+    if (!m_threads.isEmpty()) {
+        QEventLoop loop;
+        int pending = m_threads.size();
+        for (QThread *thread : qAsConst(m_threads)) {
+            QObject *barrier = new QObject;
+            barrier->moveToThread(thread);
+            connect(barrier, &QObject::destroyed, &loop, [&loop, &pending]() {
+                if (--pending == 0) {
+                    loop.quit();
+                }
+            });
+            barrier->deleteLater();
+        }
+        QTimer::singleShot(shutdownTimeout, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+    for (QThread *thread : qAsConst(m_threads)) {
+        thread->quit();
+    }
+    for (QThread *thread : qAsConst(m_threads)) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+void StressRun::start()
+{
+    m_baselineThreads = processThreadCount();
+    m_baselineRss = residentSetSize();
+
+    const bool dedicated = m_options.threading == QLatin1String("dedicated");
+    if (!dedicated) {
+        m_pool.reset(new QWebSocketThreadPool);
+        if (m_options.poolThreads > 0) {
+            m_pool->setMaxThreadCount(m_options.poolThreads);
+        }
+    }
+
+    m_clients.reserve(m_options.sockets);
+    for (int i = 0; i < m_options.sockets; ++i) {
+        QWebSocketThreaded *socket;
+        if (dedicated) {
+            // The design before the pool: a network thread per socket
+            QThread *thread = new QThread;
+            thread->setObjectName(QStringLiteral("StressRun #%1").arg(i));
+            thread->start();
+            m_threads.append(thread);
+            socket = new QWebSocketThreaded(thread);
+        } else {
+            socket = new QWebSocketThreaded(m_pool.data());
+        }
+        if (m_options.ringTransport) {
+            socket->setTransport(QWebSocketThreaded::RingTransport);
+        }
+        socket->setBatchMessages(m_options.batch);
+        socket->setCoalesceSends(m_options.coalesce);
+        socket->setCoalesceDelay(m_options.coalesceDelay);
+
+        const int index = m_clients.size();
+        connect(socket, &QWebSocketThreaded::connected, this, &StressRun::onConnected);
+        connect(socket, static_cast<void (QWebSocketThreaded::*)(QAbstractSocket::SocketError)>(&QWebSocketThreaded::error),
+                this, &StressRun::onError);
+        if (m_options.batch) {
+            connect(socket, &QWebSocketThreaded::messagesReceived, this,
+                    [this, index](const QVariantList &messages) {
+                received(index, messages.size());
+            });
+        } else if (m_options.binary) {
+            connect(socket, &QWebSocketThreaded::binaryMessageReceived, this, [this, index]() {
+                received(index, 1);
+            });
+        } else {
+            connect(socket, &QWebSocketThreaded::textMessageReceived, this, [this, index]() {
+                received(index, 1);
+            });
+        }
+
+        Client client;
+        client.socket = socket;
+        client.sent = 0;
+        client.received = 0;
+        m_clients.append(client);
+    }
+    for (const Client &client : qAsConst(m_clients)) {
+        client.socket->open(m_url);
+    }
+    m_sampleTimer.start();
+    m_timeoutTimer.start(m_options.timeout * 1000);
+}
+
+void StressRun::onConnected()
+{
+    if (m_finishedAt < 0 && ++m_openClients == m_clients.size()) {
+        begin();
+    }
+}
+
+void StressRun::onError()
+{
+    if (m_finishedAt >= 0) {
+        return;
+    }
+    qWarning("%s", qPrintable(static_cast<QWebSocketThreaded *>(sender())->errorString()));
+    m_failed = true;
+    finish();
+}
+
+void StressRun::onStallTick()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    m_stalls.append(qMax<qint64>(0, now - m_lastTick - stallInterval));
+    m_lastTick = now;
+}
+
+void StressRun::onSendTick()
+{
+    const qint64 elapsed = m_clock.nsecsElapsed();
+    const int due = int(qMin<qint64>(m_count, elapsed * m_options.rate / 1000000000 + 1));
+    for (Client &client : m_clients) {
+        while (client.sent < due) {
+            send(client);
+        }
+    }
+    if (due == m_count) {
+        m_sendTimer.stop();
+    }
+}
+
+void StressRun::onSampleTick()
+{
+    m_peakThreads = qMax(m_peakThreads, processThreadCount());
+    m_peakRss = qMax(m_peakRss, residentSetSize());
+}
+
+void StressRun::onTimeout()
+{
+    m_timedOut = true;
+    finish();
+}
+
+void StressRun::received(int index, int count)
+{
+    if (m_startedAt < 0 || m_finishedAt >= 0) {
+        return;
+    }
+    Client &client = m_clients[index];
+    const qint64 now = m_clock.nsecsElapsed();
+    // The echo server keeps the order, so the oldest messages are the ones
+    // that came back
+    for (int i = 0; i < count && !client.sentAt.isEmpty(); ++i) {
+        m_latencies.append(now - client.sentAt.dequeue());
+        ++client.received;
+    }
+    if (client.received == m_count && ++m_finishedClients == m_clients.size()) {
+        finish();
+    }
+}
+
+void StressRun::send(Client &client)
+{
+    client.sentAt.enqueue(m_clock.nsecsElapsed());
+    ++client.sent;
+    if (m_options.binary) {
+        client.socket->sendBinaryMessage(m_binaryPayload);
+    } else {
+        client.socket->sendTextMessage(m_textPayload);
+    }
+}
+
+void StressRun::begin()
+{
+    m_networkThreads = m_pool ? m_pool->activeThreadCount() : m_threads.size();
+    onSampleTick();
+    m_clock.start();
+    m_startedAt = 0;
+    m_lastTick = 0;
+    m_cpuStarted = processCpuTime();
+    m_guiCpuStarted = threadCpuTime();
+    m_writesStarted = socketWriteCalls();
+    m_writtenStarted = socketWriteBytes();
+    m_stallTimer.start();
+    onSendTick();
+    m_sendTimer.start();
+}
+
+void StressRun::finish()
+{
+    if (m_finishedAt >= 0) {
+        return;
+    }
+    m_finishedAt = m_startedAt < 0 ? 0 : m_clock.nsecsElapsed();
+    m_cpuFinished = processCpuTime();
+    m_guiCpuFinished = threadCpuTime();
+    m_writesFinished = socketWriteCalls();
+    m_writtenFinished = socketWriteBytes();
+    onSampleTick();
+    m_stallTimer.stop();
+    m_sendTimer.stop();
+    m_sampleTimer.stop();
+    m_timeoutTimer.stop();
+    Q_EMIT finished();
+}
+
+QJsonObject StressRun::report() const
+{
+    QJsonObject report;
+    report.insert(QStringLiteral("threading"), m_options.threading);
+    report.insert(QStringLiteral("transport"), m_options.ringTransport
+                  ? QStringLiteral("ring") : QStringLiteral("signal"));
+    report.insert(QStringLiteral("batch"), m_options.batch);
+    report.insert(QStringLiteral("sockets"), m_options.sockets);
+    report.insert(QStringLiteral("size"), m_options.size);
+    report.insert(QStringLiteral("rate"), m_options.rate);
+    report.insert(QStringLiteral("binary"), m_options.binary);
+    report.insert(QStringLiteral("coalesce"), m_options.coalesce);
+    if (m_options.coalesce) {
+        report.insert(QStringLiteral("coalesceDelayMs"), m_options.coalesceDelay);
+    }
+    report.insert(QStringLiteral("failed"), m_failed);
+    report.insert(QStringLiteral("timedOut"), m_timedOut);
+
+    report.insert(QStringLiteral("networkThreads"), m_networkThreads);
+    if (m_peakThreads >= 0) {
+        // Includes the server thread and whatever Qt itself runs
+        report.insert(QStringLiteral("processThreads"), m_peakThreads);
+        report.insert(QStringLiteral("addedThreads"), m_peakThreads - m_baselineThreads);
+    }
+    if (m_peakRss >= 0) {
+        // Includes the server side of the connections
+        report.insert(QStringLiteral("rssBytes"), double(m_peakRss));
+        report.insert(QStringLiteral("rssBytesPerSocket"),
+                      double(m_peakRss - m_baselineRss) / m_options.sockets);
+    }
+
+    const int messages = m_latencies.size();
+    const double seconds = m_finishedAt / 1e9;
+    const double cpuSeconds = (m_cpuFinished - m_cpuStarted) / 1e9;
+    report.insert(QStringLiteral("messages"), messages);
+    report.insert(QStringLiteral("durationMs"), m_finishedAt / 1e6);
+    if (seconds > 0) {
+        report.insert(QStringLiteral("messagesPerSecond"), messages / seconds);
+        // How many cores the process kept busy on average
+        report.insert(QStringLiteral("cpuCores"), cpuSeconds / seconds);
+    }
+    if (messages > 0) {
+        // The echo server runs in this process too, so the process time
+        // includes its share
+        report.insert(QStringLiteral("cpuUsPerMessage"), cpuSeconds * 1e6 / messages);
+        if (m_guiCpuStarted >= 0) {
+            report.insert(QStringLiteral("guiCpuUsPerMessage"),
+                          (m_guiCpuFinished - m_guiCpuStarted) / 1e3 / messages);
+        }
+    }
+    if (cpuSeconds > 0) {
+        report.insert(QStringLiteral("messagesPerCpuSecond"), messages / cpuSeconds);
+    }
+    qint64 stalled = 0;
+    for (qint64 stall : qAsConst(m_stalls)) {
+        stalled += stall;
+    }
+    if (socketWritesSupported()) {
+        // Only the client sockets, the echo server's writes are left out
+        int sent = 0;
+        for (const Client &client : m_clients) {
+            sent += client.sent;
+        }
+        const qint64 writes = m_writesFinished - m_writesStarted;
+        report.insert(QStringLiteral("socketWrites"), double(writes));
+        report.insert(QStringLiteral("socketWriteBytes"), double(m_writtenFinished - m_writtenStarted));
+        if (sent > 0) {
+            report.insert(QStringLiteral("socketWritesPerMessage"), double(writes) / sent);
+        }
+        if (writes > 0) {
+            report.insert(QStringLiteral("messagesPerSocketWrite"), double(sent) / writes);
+        }
+    }
+    report.insert(QStringLiteral("stallMs"), stalled / 1e6);
+    report.insert(QStringLiteral("latencyUs"), summarize(m_latencies));
+    report.insert(QStringLiteral("stallUs"), summarize(m_stalls));
+    return report;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,156 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef STRESSRUN_H
+#define STRESSRUN_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QObject>
+#include <QQueue>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QThread;
+class QWebSocketThreaded;
+class QWebSocketThreadPool;
+
+struct StressOptions
+{
+    // "pool" or "dedicated"
+    QString threading;
+    int sockets;
+    // Threads of the pool, QThread::idealThreadCount() when 0
+    int poolThreads;
+    int size;
+    int rate;
+    int duration;
+    bool binary;
+    bool batch;
+    bool ringTransport;
+    // QWebSocketThreaded::setCoalesceSends() and setCoalesceDelay()
+    bool coalesce;
+    int coalesceDelay;
+    int timeout;
+};
+
+// One scaling step: opens the sockets, has every one of them send at the
+// given rate for the given duration, and measures the echoes, the GUI thread
+// stalls and what the process spent on them.
+class StressRun : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(StressRun)
+
+public:
+    StressRun(const StressOptions &options, const QUrl &url, QObject *parent = Q_NULLPTR);
+    ~StressRun();
+
+    void start();
+    QJsonObject report() const;
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void onConnected();
+    void onError();
+    void onStallTick();
+    void onSendTick();
+    void onSampleTick();
+    void onTimeout();
+
+private:
+    struct Client
+    {
+        QWebSocketThreaded *socket;
+        QQueue<qint64> sentAt;
+        int sent;
+        int received;
+    };
+
+    StressOptions m_options;
+    QUrl m_url;
+    int m_count;
+    QScopedPointer<QWebSocketThreadPool> m_pool;
+    // One per socket with the dedicated threading
+    QVector<QThread *> m_threads;
+    QVector<Client> m_clients;
+    QString m_textPayload;
+    QByteArray m_binaryPayload;
+
+    QElapsedTimer m_clock;
+    QTimer m_stallTimer;
+    QTimer m_sendTimer;
+    QTimer m_sampleTimer;
+    QTimer m_timeoutTimer;
+    int m_openClients;
+    int m_finishedClients;
+    bool m_timedOut;
+    bool m_failed;
+    qint64 m_lastTick;
+    qint64 m_startedAt;
+    qint64 m_finishedAt;
+    qint64 m_cpuStarted;
+    qint64 m_cpuFinished;
+    qint64 m_guiCpuStarted;
+    qint64 m_guiCpuFinished;
+    qint64 m_writesStarted;
+    qint64 m_writesFinished;
+    qint64 m_writtenStarted;
+    qint64 m_writtenFinished;
+    int m_networkThreads;
+    int m_baselineThreads;
+    int m_peakThreads;
+    qint64 m_baselineRss;
+    qint64 m_peakRss;
+
+    QVector<qint64> m_stalls;
+    QVector<qint64> m_latencies;
+
+    void received(int index, int count);
+    void send(Client &client);
+    void begin();
+    void finish();
+};
+
+QT_END_NAMESPACE
+
+#endif // STRESSRUN_H
@@ -1,11 +1,39 @@
-QT += websockets qml
+QT += websockets qml quick
+
+qtConfig(system-zlib): QMAKE_USE_PRIVATE += zlib
+else: QT_PRIVATE += zlib-private
+
+include($$PWD/qmlwebsockets_threaded_tracepoints.pri)
 
 HEADERS +=  $$PWD/qmlwebsocketsthreaded_plugin.h \
             $$PWD/qwebsocketthreaded.h \
+            $$PWD/qwebsocketthreaded_p.h \
+            $$PWD/qwebsocketthreadedbufferpool.h \
+            $$PWD/qwebsocketthreadedcodec_p.h \
+            $$PWD/qwebsocketthreadeddeflate_p.h \
+            $$PWD/qwebsocketthreadedfilter.h \
+            $$PWD/qwebsocketthreadedprocessor.h \
+            $$PWD/qwebsocketthreadedring_p.h \
+            $$PWD/qwebsocketthreadedstats.h \
+            $$PWD/qwebsocketthreadedtrace_p.h \
+            $$PWD/qwebsocketthreadpool.h \
+            $$PWD/qqmlwebsocketchannel.h \
+            $$PWD/qqmlwebsocketlistmodel.h \
             $$PWD/qqmlwebsocketthreaded.h
 
 SOURCES +=  $$PWD/qmlwebsocketsthreaded_plugin.cpp \
             $$PWD/qwebsocketthreaded.cpp \
+            $$PWD/qwebsocketthreaded_p.cpp \
+            $$PWD/qwebsocketthreadedbufferpool.cpp \
+            $$PWD/qwebsocketthreadedcodec_p.cpp \
+            $$PWD/qwebsocketthreadeddeflate_p.cpp \
+            $$PWD/qwebsocketthreadedfilter.cpp \
+            $$PWD/qwebsocketthreadedprocessor.cpp \
+            $$PWD/qwebsocketthreadedstats.cpp \
+            $$PWD/qwebsocketthreadpool.cpp \
+            $$PWD/qqmlwebsocketchannel.cpp \
+            $$PWD/qqmlwebsocketlistmodel.cpp \
             $$PWD/qqmlwebsocketthreaded.cpp
 
-OTHER_FILES += $$PWD/qmldir
+OTHER_FILES += $$PWD/qmldir \
+               $$PWD/qtwebsocketsthreaded.tracepoints
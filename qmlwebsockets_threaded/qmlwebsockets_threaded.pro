@@ -1,16 +1,45 @@
-QT += websockets qml
+QT += websockets qml quick
+
+qtConfig(system-zlib): QMAKE_USE_PRIVATE += zlib
+else: QT_PRIVATE += zlib-private
+
+include(qmlwebsockets_threaded_tracepoints.pri)
 
 TARGETPATH = QtWebSocketsThreaded
 
 HEADERS +=  qmlwebsocketsthreaded_plugin.h \
             qwebsocketthreaded.h \
+            qwebsocketthreaded_p.h \
+            qwebsocketthreadedbufferpool.h \
+            qwebsocketthreadedcodec_p.h \
+            qwebsocketthreadeddeflate_p.h \
+            qwebsocketthreadedfilter.h \
+            qwebsocketthreadedprocessor.h \
+            qwebsocketthreadedring_p.h \
+            qwebsocketthreadedstats.h \
+            qwebsocketthreadedtrace_p.h \
+            qwebsocketthreadpool.h \
+            qqmlwebsocketchannel.h \
+            qqmlwebsocketlistmodel.h \
             qqmlwebsocketthreaded.h
 
 SOURCES +=  qmlwebsocketsthreaded_plugin.cpp \
             qwebsocketthreaded.cpp \
+            qwebsocketthreaded_p.cpp \
+            qwebsocketthreadedbufferpool.cpp \
+            qwebsocketthreadedcodec_p.cpp \
+            qwebsocketthreadeddeflate_p.cpp \
+            qwebsocketthreadedfilter.cpp \
+            qwebsocketthreadedprocessor.cpp \
+            qwebsocketthreadedstats.cpp \
+            qwebsocketthreadpool.cpp \
+            qqmlwebsocketchannel.cpp \
+            qqmlwebsocketlistmodel.cpp \
             qqmlwebsocketthreaded.cpp
 
-OTHER_FILES += qmldir
+OTHER_FILES += qmldir \
+               qmlwebsockets_threaded_tracepoints.pri \
+               qtwebsocketsthreaded.tracepoints
 
 IMPORT_VERSION = 1.0
 load(qml_plugin)
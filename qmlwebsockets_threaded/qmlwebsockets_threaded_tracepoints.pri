@@ -0,0 +1,9 @@
+# Tracepoints for the LTTng or ETW backend Qt was configured with, shared by
+# the plugin and everything built from qmlwebsockets_threaded.pri
+QT_FOR_CONFIG += core-private
+qtConfig(lttng)|qtConfig(etw) {
+    TRACEPOINT_PROVIDER = $$PWD/qtwebsocketsthreaded.tracepoints
+    CONFIG += qt_tracepoints
+    QT_PRIVATE += core-private
+    DEFINES += QWEBSOCKETTHREADED_TRACEPOINTS
+}
@@ -42,10 +42,24 @@
 
 #include <QtQml>
 
+#include "qqmlwebsocketchannel.h"
+#include "qqmlwebsocketlistmodel.h"
 #include "qqmlwebsocketthreaded.h"
+#include "qwebsocketthreadedstats.h"
+#include "qwebsocketthreadpool.h"
 
 QT_BEGIN_NAMESPACE
 
+static QObject *threadPoolProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
+{
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+    QWebSocketThreadPool *pool = QWebSocketThreadPool::globalInstance();
+    // the pool is process-wide and outlives any engine
+    QQmlEngine::setObjectOwnership(pool, QQmlEngine::CppOwnership);
+    return pool;
+}
+
 void QtWebSocketsThreadedDeclarativeModule::registerTypes(const char *uri)
 {
     Q_ASSERT(uri == QLatin1String("QtWebSocketsThreaded"));
@@ -55,6 +69,13 @@ void QtWebSocketsThreadedDeclarativeModule::registerTypes(const char *uri)
     qRegisterMetaType<QAbstractSocket::SocketState>("QAbstractSocket::SocketState");
     qmlRegisterType<QQmlWebSocketThreaded>(uri, 1 /*major*/, 0 /*minor*/, "WebSocket");
     qmlRegisterType<QQmlWebSocketThreaded, 1>(uri, 1 /*major*/, 1 /*minor*/, "WebSocket");
+    qmlRegisterType<QQmlWebSocketThreaded, 2>(uri, 1 /*major*/, 2 /*minor*/, "WebSocket");
+    qmlRegisterSingletonType<QWebSocketThreadPool>(uri, 1 /*major*/, 2 /*minor*/, "WebSocketThreadPool",
+                                                   threadPoolProvider);
+    qmlRegisterUncreatableType<QWebSocketThreadedStats>(uri, 1 /*major*/, 2 /*minor*/, "WebSocketStats",
+                                                        QStringLiteral("WebSocketStats is provided by WebSocket.stats"));
+    qmlRegisterType<QQmlWebSocketChannel>(uri, 1 /*major*/, 2 /*minor*/, "WebSocketChannel");
+    qmlRegisterType<QQmlWebSocketListModel>(uri, 1 /*major*/, 2 /*minor*/, "WebSocketListModel");
 }
 
 QT_END_NAMESPACE
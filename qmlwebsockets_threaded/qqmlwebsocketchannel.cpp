@@ -0,0 +1,409 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+/*!
+    \qmltype WebSocketChannel
+    \instantiates QQmlWebSocketChannel
+    \since QtWebSocketsThreaded 1.2
+
+    \inqmlmodule QtWebSocketsThreaded
+    \ingroup websockets-qml
+    \brief A logical channel on a WebSocket connection shared by url.
+
+    All the active channels with the same \l url share one connection, which
+    is opened with the first one and closed with the last one. Every message
+    is tagged with the \l channel id and routed on the network thread, so a
+    channel only receives its own messages. Text messages are framed as
+    \c {channel:payload}, binary messages start with one byte holding the
+    length of the UTF-8 channel id, followed by the id and the payload.
+
+    \qml
+    WebSocketChannel {
+        url: "wss://example.com/feed"
+        channel: "quotes"
+        active: true
+        onTextMessageReceived: console.log(message)
+    }
+    \endqml
+*/
+
+/*!
+  \qmlproperty QUrl WebSocketChannel::url
+  Server url of the shared connection.
+  */
+
+/*!
+  \qmlproperty string WebSocketChannel::channel
+  Id of the channel. The UTF-8 id has to fit in 255 bytes to send binary
+  messages and can't contain ':' to send text messages.
+  */
+
+/*!
+  \qmlproperty Status WebSocketChannel::status
+  Status of the shared connection, with the same values as WebSocket::status.
+  */
+
+/*!
+  \qmlproperty QString WebSocketChannel::errorString
+  Contains a description of the last error that occurred. When no error
+  occurrred, this string is empty.
+  */
+
+/*!
+  \qmlproperty bool WebSocketChannel::active
+  When set to true, the channel joins the connection of its url, which is
+  opened if needed. When set to false, the channel leaves it, and the
+  connection is closed if this was the last channel. The default value is
+  false.
+  */
+
+/*!
+  \qmlmethod void WebSocketChannel::sendTextMessage(string message)
+  Sends \c message on this channel.
+  */
+
+/*!
+  \qmlmethod void WebSocketChannel::sendBinaryMessage(ArrayBuffer message)
+  Sends \c message on this channel.
+  */
+
+/*!
+  \qmlsignal WebSocketChannel::textMessageReceived(string message)
+  This signal is emitted when a text message for this channel is received.
+  */
+
+/*!
+  \qmlsignal WebSocketChannel::binaryMessageReceived(ArrayBuffer message)
+  This signal is emitted when a binary message for this channel is received.
+  */
+
+#include "qqmlwebsocketchannel.h"
+
+QT_BEGIN_NAMESPACE
+
+// One shared connection, only used from the GUI thread
+class QWebSocketThreadedChannelHub : public QObject
+{
+public:
+    static QWebSocketThreadedChannelHub *acquire(const QUrl &url, QQmlWebSocketChannel *channel);
+    void release(QQmlWebSocketChannel *channel);
+
+    QWebSocketThreaded *socket() const { return m_socket; }
+
+private:
+    explicit QWebSocketThreadedChannelHub(const QUrl &url);
+
+    QUrl m_url;
+    QWebSocketThreaded *m_socket;
+    // state() only changes once the network thread ran the open
+    bool m_opening;
+    QMultiHash<QString, QQmlWebSocketChannel *> m_channels;
+};
+
+typedef QHash<QUrl, QWebSocketThreadedChannelHub *> QWebSocketThreadedChannelHubs;
+Q_GLOBAL_STATIC(QWebSocketThreadedChannelHubs, theHubs)
+
+QWebSocketThreadedChannelHub::QWebSocketThreadedChannelHub(const QUrl &url)
+    : QObject(),
+      m_url(url),
+      m_socket(new QWebSocketThreaded(QString(), QWebSocketProtocol::VersionLatest, this)),
+      m_opening(false)
+{
+    m_socket->setMultiplexed(true);
+    // Handlers may leave the channel or the connection, so they are called
+    // for a copy of the list
+    connect(m_socket, &QWebSocketThreaded::channelTextMessageReceived, this,
+            [this](const QString &channel, const QString &message) {
+        const QList<QQmlWebSocketChannel *> channels = m_channels.values(channel);
+        for (QQmlWebSocketChannel *target : channels) {
+            Q_EMIT target->textMessageReceived(message);
+        }
+    });
+    connect(m_socket, &QWebSocketThreaded::channelBinaryMessageReceived, this,
+            [this](const QString &channel, const QByteArray &message) {
+        const QList<QQmlWebSocketChannel *> channels = m_channels.values(channel);
+        for (QQmlWebSocketChannel *target : channels) {
+            Q_EMIT target->binaryMessageReceived(message);
+        }
+    });
+    connect(m_socket, &QWebSocketThreaded::stateChanged, this,
+            [this](QAbstractSocket::SocketState state) {
+        m_opening = false;
+        const QList<QQmlWebSocketChannel *> channels = m_channels.values();
+        for (QQmlWebSocketChannel *target : channels) {
+            target->onStateChanged(state);
+        }
+    });
+    typedef void (QWebSocketThreaded::* ErrorSignal)(QAbstractSocket::SocketError);
+    connect(m_socket, static_cast<ErrorSignal>(&QWebSocketThreaded::error), this, [this]() {
+        m_opening = false;
+        const QList<QQmlWebSocketChannel *> channels = m_channels.values();
+        for (QQmlWebSocketChannel *target : channels) {
+            target->onError(m_socket->errorString());
+        }
+    });
+}
+
+QWebSocketThreadedChannelHub *QWebSocketThreadedChannelHub::acquire(const QUrl &url,
+                                                                    QQmlWebSocketChannel *channel)
+{
+    QWebSocketThreadedChannelHub *&hub = (*theHubs())[url];
+    if (!hub) {
+        hub = new QWebSocketThreadedChannelHub(url);
+    }
+    hub->m_channels.insert(channel->m_channel, channel);
+    hub->m_socket->setChannels(hub->m_channels.uniqueKeys());
+    if (!hub->m_opening && hub->m_socket->state() == QAbstractSocket::UnconnectedState) {
+        hub->m_opening = true;
+        hub->m_socket->open(url);
+    }
+    return hub;
+}
+
+void QWebSocketThreadedChannelHub::release(QQmlWebSocketChannel *channel)
+{
+    m_channels.remove(channel->m_channel, channel);
+    if (!m_channels.isEmpty()) {
+        m_socket->setChannels(m_channels.uniqueKeys());
+        return;
+    }
+    // Deferred, this may run from one of the handlers above
+    theHubs()->remove(m_url);
+    m_socket->close();
+    deleteLater();
+}
+
+QQmlWebSocketChannel::QQmlWebSocketChannel(QObject *parent) :
+    QObject(parent),
+    m_hub(Q_NULLPTR),
+    m_url(),
+    m_channel(),
+    m_status(Closed),
+    m_isActive(false),
+    m_componentCompleted(true),
+    m_errorString()
+{
+}
+
+QQmlWebSocketChannel::~QQmlWebSocketChannel()
+{
+    detach();
+}
+
+void QQmlWebSocketChannel::sendTextMessage(const QString &message)
+{
+    if (!canSend()) {
+        return;
+    }
+    if (m_channel.contains(QLatin1Char(':'))) {
+        setErrorString(tr("The channel id can't contain ':' for text messages."));
+        setStatus(Error);
+        return;
+    }
+    m_hub->socket()->sendChannelTextMessage(m_channel, message);
+}
+
+void QQmlWebSocketChannel::sendBinaryMessage(const QByteArray &message)
+{
+    if (!canSend()) {
+        return;
+    }
+    if (m_channel.toUtf8().size() > 255) {
+        setErrorString(tr("The channel id is too long for binary messages."));
+        setStatus(Error);
+        return;
+    }
+    m_hub->socket()->sendChannelBinaryMessage(m_channel, message);
+}
+
+QUrl QQmlWebSocketChannel::url() const
+{
+    return m_url;
+}
+
+void QQmlWebSocketChannel::setUrl(const QUrl &url)
+{
+    if (m_url == url) {
+        return;
+    }
+    detach();
+    m_url = url;
+    Q_EMIT urlChanged();
+    attach();
+}
+
+QString QQmlWebSocketChannel::channel() const
+{
+    return m_channel;
+}
+
+void QQmlWebSocketChannel::setChannel(const QString &channel)
+{
+    if (m_channel == channel) {
+        return;
+    }
+    detach();
+    m_channel = channel;
+    Q_EMIT channelChanged();
+    attach();
+}
+
+QQmlWebSocketChannel::Status QQmlWebSocketChannel::status() const
+{
+    return m_status;
+}
+
+QString QQmlWebSocketChannel::errorString() const
+{
+    return m_errorString;
+}
+
+void QQmlWebSocketChannel::setActive(bool active)
+{
+    if (m_isActive == active) {
+        return;
+    }
+    m_isActive = active;
+    Q_EMIT activeChanged(m_isActive);
+    if (m_isActive) {
+        attach();
+    } else {
+        detach();
+    }
+}
+
+bool QQmlWebSocketChannel::isActive() const
+{
+    return m_isActive;
+}
+
+void QQmlWebSocketChannel::classBegin()
+{
+    m_componentCompleted = false;
+    m_errorString = tr("QQmlWebSocketChannel is not ready.");
+    m_status = Closed;
+}
+
+void QQmlWebSocketChannel::componentComplete()
+{
+    m_componentCompleted = true;
+    attach();
+}
+
+void QQmlWebSocketChannel::attach()
+{
+    if (m_hub || !m_componentCompleted || !m_isActive || !m_url.isValid()) {
+        return;
+    }
+    m_hub = QWebSocketThreadedChannelHub::acquire(m_url, this);
+    onStateChanged(m_hub->socket()->state());
+}
+
+void QQmlWebSocketChannel::detach()
+{
+    if (!m_hub) {
+        return;
+    }
+    m_hub->release(this);
+    m_hub = Q_NULLPTR;
+    setStatus(Closed);
+}
+
+bool QQmlWebSocketChannel::canSend()
+{
+    if (m_hub && m_status == Open) {
+        return true;
+    }
+    setErrorString(tr("Messages can only be sent when the socket is open."));
+    setStatus(Error);
+    return false;
+}
+
+void QQmlWebSocketChannel::onStateChanged(QAbstractSocket::SocketState state)
+{
+    switch (state)
+    {
+        case QAbstractSocket::UnconnectedState:
+        {
+            setStatus(Closed);
+            break;
+        }
+        case QAbstractSocket::ConnectedState:
+        {
+            setStatus(Open);
+            break;
+        }
+        case QAbstractSocket::ClosingState:
+        {
+            setStatus(Closing);
+            break;
+        }
+        default:
+        {
+            setStatus(Connecting);
+            break;
+        }
+    }
+}
+
+void QQmlWebSocketChannel::onError(const QString &errorString)
+{
+    setErrorString(errorString);
+    setStatus(Error);
+}
+
+void QQmlWebSocketChannel::setStatus(QQmlWebSocketChannel::Status status)
+{
+    if (m_status == status) {
+        return;
+    }
+    m_status = status;
+    if (status != Error) {
+        setErrorString();
+    }
+    Q_EMIT statusChanged(m_status);
+}
+
+void QQmlWebSocketChannel::setErrorString(QString errorString)
+{
+    if (m_errorString == errorString) {
+        return;
+    }
+    m_errorString = errorString;
+    Q_EMIT errorStringChanged(m_errorString);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,126 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QQMLWEBSOCKETCHANNEL_H
+#define QQMLWEBSOCKETCHANNEL_H
+
+#include <QObject>
+#include <QQmlParserStatus>
+#include <QtQml>
+#include <QUrl>
+#include "qwebsocketthreaded.h"
+
+QT_BEGIN_NAMESPACE
+
+class QWebSocketThreadedChannelHub;
+
+// A logical channel on a connection shared by all the channels with the same
+// url, see QWebSocketThreaded::multiplexed() for the framing.
+class QQmlWebSocketChannel : public QObject, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QQmlWebSocketChannel)
+    Q_INTERFACES(QQmlParserStatus)
+
+    Q_PROPERTY(QUrl url READ url WRITE setUrl NOTIFY urlChanged)
+    Q_PROPERTY(QString channel READ channel WRITE setChannel NOTIFY channelChanged)
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+
+public:
+    explicit QQmlWebSocketChannel(QObject *parent = Q_NULLPTR);
+    virtual ~QQmlWebSocketChannel();
+
+    enum Status
+    {
+        Connecting  = 0,
+        Open        = 1,
+        Closing     = 2,
+        Closed      = 3,
+        Error       = 4
+    };
+    Q_ENUM(Status)
+
+    QUrl url() const;
+    void setUrl(const QUrl &url);
+    QString channel() const;
+    void setChannel(const QString &channel);
+    Status status() const;
+    QString errorString() const;
+
+    void setActive(bool active);
+    bool isActive() const;
+
+    Q_INVOKABLE void sendTextMessage(const QString &message);
+    Q_INVOKABLE void sendBinaryMessage(const QByteArray &message);
+
+Q_SIGNALS:
+    void textMessageReceived(QString message);
+    void binaryMessageReceived(const QByteArray &message);
+    void statusChanged(Status status);
+    void activeChanged(bool isActive);
+    void errorStringChanged(QString errorString);
+    void urlChanged();
+    void channelChanged();
+
+public:
+    void classBegin() Q_DECL_OVERRIDE;
+    void componentComplete() Q_DECL_OVERRIDE;
+
+private:
+    friend class QWebSocketThreadedChannelHub;
+
+    QWebSocketThreadedChannelHub *m_hub;
+    QUrl m_url;
+    QString m_channel;
+    Status m_status;
+    bool m_isActive;
+    bool m_componentCompleted;
+    QString m_errorString;
+
+    void attach();
+    void detach();
+    bool canSend();
+    void onStateChanged(QAbstractSocket::SocketState state);
+    void onError(const QString &errorString);
+    void setStatus(Status status);
+    void setErrorString(QString errorString = QString());
+};
+
+QT_END_NAMESPACE
+
+#endif // QQMLWEBSOCKETCHANNEL_H
@@ -0,0 +1,498 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+/*!
+    \qmltype WebSocketListModel
+    \instantiates QQmlWebSocketListModel
+    \since QtWebSocketsThreaded 1.2
+
+    \inqmlmodule QtWebSocketsThreaded
+    \ingroup websockets-qml
+    \brief A list model fed by the JSON messages of a WebSocket.
+
+    Replaces the usual \c onTextMessageReceived, \c JSON.parse and
+    \c ListModel.append chain. The messages of the \l source socket are
+    parsed on its network thread, every JSON object, or every object of a
+    JSON array, is a row. With a \l keyPath, a row replaces the row with the
+    same key instead of being appended, and rows equal to the current one are
+    dropped there too. The rows staged since the last update are applied to
+    the model together, with one insertion and one \c dataChanged() per
+    range of consecutive changed rows, once per turn of the GUI event loop.
+
+    \qml
+    WebSocket {
+        id: socket
+        url: "wss://example.com/quotes"
+        active: true
+    }
+    WebSocketListModel {
+        id: quotes
+        source: socket
+        keyPath: "symbol"
+        roles: ["symbol", "price"]
+    }
+    ListView {
+        model: quotes
+        delegate: Text { text: symbol + " " + price }
+    }
+    \endqml
+
+    The model takes the place of the \l {WebSocket::processorSource}
+    {processor} of the socket, and the messages it consumes are counted in
+    \c stats.messagesFiltered. Messages that are not JSON objects or arrays are
+    still delivered with \l {WebSocket::processedMessageReceived()}
+    {processedMessageReceived()}.
+*/
+
+/*!
+  \qmlproperty WebSocket WebSocketListModel::source
+  The socket whose messages fill the model.
+  */
+
+/*!
+  \qmlproperty string WebSocketListModel::keyPath
+  Dot separated path of the value identifying a row, as in
+  \l {WebSocket::filters}{WebSocket.filters}. Rows without a scalar value
+  there are appended. Changing it clears the model. The default value is an
+  empty string, where every row is appended.
+  */
+
+/*!
+  \qmlproperty list<string> WebSocketListModel::roles
+  The members of the rows exposed as roles. When empty, the members of the
+  first row are used.
+  */
+
+/*!
+  \qmlproperty int WebSocketListModel::count
+  The number of rows.
+  */
+
+/*!
+  \qmlmethod object WebSocketListModel::get(int row)
+  Returns the row at \a row with all its members.
+  */
+
+/*!
+  \qmlmethod void WebSocketListModel::clear()
+  Removes all the rows.
+  */
+
+#include "qqmlwebsocketlistmodel.h"
+
+#include <QAtomicInt>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QMetaObject>
+#include <QMutex>
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+struct QWebSocketListModelRow
+{
+    // Null without a key
+    QString key;
+    QVariantMap values;
+};
+Q_DECLARE_TYPEINFO(QWebSocketListModelRow, Q_MOVABLE_TYPE);
+
+// Rows staged by the processor for the model, shared between the two threads
+struct QWebSocketListModelStage
+{
+    QWebSocketListModelStage() : model(Q_NULLPTR), generation(0) {}
+
+    QMutex mutex;
+    // Null once the model let go of the stage
+    QObject *model;
+    // At most one per key, in the order the keys were first staged
+    QVector<QWebSocketListModelRow> rows;
+    // Index in rows
+    QHash<QString, int> keys;
+    // Bumped when the model is cleared, the processor forgets its rows then
+    QAtomicInt generation;
+};
+
+// Undefined if the path doesn't exist
+static QJsonValue valueAt(const QJsonObject &object, const QStringList &path)
+{
+    QJsonValue value(object);
+    for (const QString &key : path) {
+        if (value.isArray()) {
+            bool isIndex = false;
+            const int index = key.toInt(&isIndex);
+            const QJsonArray array = value.toArray();
+            value = isIndex && index >= 0 && index < array.size()
+                    ? array.at(index) : QJsonValue(QJsonValue::Undefined);
+        } else {
+            value = value.toObject().value(key);
+        }
+        if (value.isUndefined()) {
+            break;
+        }
+    }
+    return value;
+}
+
+class QWebSocketListModelProcessor : public QWebSocketThreadedProcessor
+{
+public:
+    QWebSocketListModelProcessor(const QSharedPointer<QWebSocketListModelStage> &stage,
+                                 const QString &keyPath)
+        : m_stage(stage),
+          m_keyPath(keyPath.isEmpty() ? QStringList() : keyPath.split(QLatin1Char('.'))),
+          m_generation(0)
+    {}
+
+    void processTextMessage(const QString &message, QVariantList *output) Q_DECL_OVERRIDE
+    {
+        if (!process(QJsonDocument::fromJson(message.toUtf8()))) {
+            output->append(message);
+        }
+    }
+
+    void processBinaryMessage(const QByteArray &message, QVariantList *output) Q_DECL_OVERRIDE
+    {
+        if (!process(QJsonDocument::fromJson(message))) {
+            output->append(message);
+        }
+    }
+
+private:
+    QSharedPointer<QWebSocketListModelStage> m_stage;
+    QStringList m_keyPath;
+    // The last row staged for every key, to drop the unchanged ones
+    QHash<QString, QJsonObject> m_last;
+    int m_generation;
+
+    bool process(const QJsonDocument &document)
+    {
+        const int generation = m_stage->generation.loadAcquire();
+        if (m_generation != generation) {
+            m_generation = generation;
+            m_last.clear();
+        }
+        QVector<QWebSocketListModelRow> rows;
+        if (document.isObject()) {
+            stage(document.object(), &rows);
+        } else if (document.isArray()) {
+            const QJsonArray array = document.array();
+            for (const QJsonValue &value : array) {
+                if (value.isObject()) {
+                    stage(value.toObject(), &rows);
+                }
+            }
+        } else {
+            return false;
+        }
+        if (!rows.isEmpty()) {
+            publish(rows);
+        }
+        return true;
+    }
+
+    void stage(const QJsonObject &object, QVector<QWebSocketListModelRow> *rows)
+    {
+        QWebSocketListModelRow row;
+        if (!m_keyPath.isEmpty()) {
+            const QJsonValue key = valueAt(object, m_keyPath);
+            if (key.isString() || key.isDouble() || key.isBool()) {
+                row.key = key.toVariant().toString();
+                QJsonObject &last = m_last[row.key];
+                if (last == object) {
+                    return;
+                }
+                last = object;
+            }
+        }
+        row.values = object.toVariantMap();
+        rows->append(row);
+    }
+
+    void publish(const QVector<QWebSocketListModelRow> &rows)
+    {
+        QMutexLocker locker(&m_stage->mutex);
+        if (!m_stage->model) {
+            return;
+        }
+        const bool wasEmpty = m_stage->rows.isEmpty();
+        for (const QWebSocketListModelRow &row : rows) {
+            const QHash<QString, int>::const_iterator it = row.key.isNull()
+                    ? m_stage->keys.constEnd() : m_stage->keys.constFind(row.key);
+            if (it != m_stage->keys.constEnd()) {
+                m_stage->rows[it.value()] = row;
+                continue;
+            }
+            if (!row.key.isNull()) {
+                m_stage->keys.insert(row.key, m_stage->rows.size());
+            }
+            m_stage->rows.append(row);
+        }
+        // Under the lock, the model can't go away meanwhile, and a queued
+        // call to a deleted object is discarded
+        if (wasEmpty) {
+            QMetaObject::invokeMethod(m_stage->model, "applyStaged", Qt::QueuedConnection);
+        }
+    }
+};
+
+QQmlWebSocketListModel::QQmlWebSocketListModel(QObject *parent) :
+    QAbstractListModel(parent),
+    m_source(),
+    m_keyPath(),
+    m_roles(),
+    m_componentCompleted(true),
+    m_stage(),
+    m_processor(),
+    m_rows(),
+    m_index(),
+    m_roleKeys()
+{
+}
+
+QQmlWebSocketListModel::~QQmlWebSocketListModel()
+{
+    detach();
+}
+
+QQmlWebSocketThreaded *QQmlWebSocketListModel::source() const
+{
+    return m_source.data();
+}
+
+void QQmlWebSocketListModel::setSource(QQmlWebSocketThreaded *source)
+{
+    if (m_source == source) {
+        return;
+    }
+    detach();
+    m_source = source;
+    attach();
+    Q_EMIT sourceChanged();
+}
+
+QString QQmlWebSocketListModel::keyPath() const
+{
+    return m_keyPath;
+}
+
+void QQmlWebSocketListModel::setKeyPath(const QString &keyPath)
+{
+    if (m_keyPath == keyPath) {
+        return;
+    }
+    detach();
+    m_keyPath = keyPath;
+    clear();
+    attach();
+    Q_EMIT keyPathChanged();
+}
+
+QStringList QQmlWebSocketListModel::roles() const
+{
+    return m_roles;
+}
+
+void QQmlWebSocketListModel::setRoles(const QStringList &roles)
+{
+    if (m_roles == roles) {
+        return;
+    }
+    beginResetModel();
+    m_roles = roles;
+    m_roleKeys = m_roles.isEmpty() && !m_rows.isEmpty() ? m_rows.first().keys() : m_roles;
+    endResetModel();
+    Q_EMIT rolesChanged();
+}
+
+int QQmlWebSocketListModel::count() const
+{
+    return m_rows.size();
+}
+
+QVariantMap QQmlWebSocketListModel::get(int row) const
+{
+    return m_rows.value(row);
+}
+
+void QQmlWebSocketListModel::clear()
+{
+    if (m_stage) {
+        QMutexLocker locker(&m_stage->mutex);
+        m_stage->rows.clear();
+        m_stage->keys.clear();
+        m_stage->generation.ref();
+    }
+    if (m_rows.isEmpty()) {
+        return;
+    }
+    beginResetModel();
+    m_rows.clear();
+    m_index.clear();
+    if (m_roles.isEmpty()) {
+        m_roleKeys.clear();
+    }
+    endResetModel();
+    Q_EMIT countChanged();
+}
+
+int QQmlWebSocketListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant QQmlWebSocketListModel::data(const QModelIndex &index, int role) const
+{
+    const int key = role - Qt::UserRole;
+    if (!index.isValid() || index.row() >= m_rows.size() || key < 0 || key >= m_roleKeys.size()) {
+        return QVariant();
+    }
+    return m_rows.at(index.row()).value(m_roleKeys.at(key));
+}
+
+QHash<int, QByteArray> QQmlWebSocketListModel::roleNames() const
+{
+    QHash<int, QByteArray> names;
+    for (int i = 0; i < m_roleKeys.size(); ++i) {
+        names.insert(Qt::UserRole + i, m_roleKeys.at(i).toUtf8());
+    }
+    return names;
+}
+
+void QQmlWebSocketListModel::classBegin()
+{
+    m_componentCompleted = false;
+}
+
+void QQmlWebSocketListModel::componentComplete()
+{
+    m_componentCompleted = true;
+    m_roleKeys = m_roles;
+    attach();
+}
+
+void QQmlWebSocketListModel::attach()
+{
+    if (!m_componentCompleted || !m_source) {
+        return;
+    }
+    m_stage.reset(new QWebSocketListModelStage);
+    m_stage->model = this;
+    m_processor.reset(new QWebSocketListModelProcessor(m_stage, m_keyPath));
+    m_source->setProcessor(m_processor);
+}
+
+void QQmlWebSocketListModel::detach()
+{
+    if (m_stage) {
+        QMutexLocker locker(&m_stage->mutex);
+        m_stage->model = Q_NULLPTR;
+    }
+    m_stage.reset();
+    // Unless something else took its place meanwhile
+    if (m_source && m_processor && m_source->processor() == m_processor) {
+        m_source->setProcessor(QSharedPointer<QWebSocketThreadedProcessor>());
+    }
+    m_processor.reset();
+}
+
+void QQmlWebSocketListModel::applyStaged()
+{
+    if (!m_stage) {
+        return;
+    }
+    QVector<QWebSocketListModelRow> rows;
+    {
+        QMutexLocker locker(&m_stage->mutex);
+        rows.swap(m_stage->rows);
+        m_stage->keys.clear();
+    }
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    if (m_roleKeys.isEmpty() && m_rows.isEmpty()) {
+        // Views only ask for the roles again after a reset
+        beginResetModel();
+        m_roleKeys = rows.first().values.keys();
+        for (const QWebSocketListModelRow &row : qAsConst(rows)) {
+            if (!row.key.isNull()) {
+                m_index.insert(row.key, m_rows.size());
+            }
+            m_rows.append(row.values);
+        }
+        endResetModel();
+        Q_EMIT countChanged();
+        return;
+    }
+
+    QVector<int> changed;
+    QVector<QVariantMap> inserted;
+    for (const QWebSocketListModelRow &row : qAsConst(rows)) {
+        const int index = row.key.isNull() ? -1 : m_index.value(row.key, -1);
+        if (index >= 0) {
+            m_rows[index] = row.values;
+            changed.append(index);
+            continue;
+        }
+        if (!row.key.isNull()) {
+            m_index.insert(row.key, m_rows.size() + inserted.size());
+        }
+        inserted.append(row.values);
+    }
+
+    // One dataChanged() per run of consecutive rows
+    std::sort(changed.begin(), changed.end());
+    for (int i = 0; i < changed.size();) {
+        int last = i;
+        while (last + 1 < changed.size() && changed.at(last + 1) == changed.at(last) + 1) {
+            ++last;
+        }
+        Q_EMIT dataChanged(index(changed.at(i)), index(changed.at(last)));
+        i = last + 1;
+    }
+
+    if (!inserted.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + inserted.size() - 1);
+        m_rows += inserted;
+        endInsertRows();
+        Q_EMIT countChanged();
+    }
+}
+
+QT_END_NAMESPACE
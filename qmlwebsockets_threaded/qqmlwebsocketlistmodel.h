@@ -0,0 +1,120 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QQMLWEBSOCKETLISTMODEL_H
+#define QQMLWEBSOCKETLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPointer>
+#include <QQmlParserStatus>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+#include <QtQml>
+#include "qqmlwebsocketthreaded.h"
+
+QT_BEGIN_NAMESPACE
+
+struct QWebSocketListModelStage;
+
+// Rows parsed from the JSON messages of a WebSocket on its network thread,
+// see the WebSocketListModel documentation.
+class QQmlWebSocketListModel : public QAbstractListModel, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QQmlWebSocketListModel)
+    Q_INTERFACES(QQmlParserStatus)
+
+    Q_PROPERTY(QQmlWebSocketThreaded *source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QString keyPath READ keyPath WRITE setKeyPath NOTIFY keyPathChanged)
+    Q_PROPERTY(QStringList roles READ roles WRITE setRoles NOTIFY rolesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    explicit QQmlWebSocketListModel(QObject *parent = Q_NULLPTR);
+    virtual ~QQmlWebSocketListModel();
+
+    QQmlWebSocketThreaded *source() const;
+    void setSource(QQmlWebSocketThreaded *source);
+    QString keyPath() const;
+    void setKeyPath(const QString &keyPath);
+    QStringList roles() const;
+    void setRoles(const QStringList &roles);
+    int count() const;
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE void clear();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+    void classBegin() Q_DECL_OVERRIDE;
+    void componentComplete() Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void sourceChanged();
+    void keyPathChanged();
+    void rolesChanged();
+    void countChanged();
+
+private Q_SLOTS:
+    // Queued by the network thread when the stage stops being empty
+    void applyStaged();
+
+private:
+    QPointer<QQmlWebSocketThreaded> m_source;
+    QString m_keyPath;
+    QStringList m_roles;
+    bool m_componentCompleted;
+    QSharedPointer<QWebSocketListModelStage> m_stage;
+    // Of the processor installed on m_source
+    QSharedPointer<QWebSocketThreadedProcessor> m_processor;
+    QVector<QVariantMap> m_rows;
+    // Row of every key
+    QHash<QString, int> m_index;
+    // m_roles, or the keys of the first row when empty
+    QStringList m_roleKeys;
+
+    void attach();
+    void detach();
+};
+
+QT_END_NAMESPACE
+
+#endif // QQMLWEBSOCKETLISTMODEL_H
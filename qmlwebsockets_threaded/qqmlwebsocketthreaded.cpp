@@ -85,6 +85,406 @@
   The default value is false.
   */
 
+/*!
+  \qmlproperty qint64 WebSocket::bufferedAmount
+  \since QtWebSocketsThreaded 1.2
+  The number of bytes of messages that were sent but not yet written to the
+  network. A message counts with its payload, UTF-8 for text, when sent, and
+  with the bytes actually written, frame headers and compression included,
+  once the network thread handed it to the socket.
+  */
+
+/*!
+  \qmlproperty qint64 WebSocket::highWaterMark
+  \since QtWebSocketsThreaded 1.2
+  When \l bufferedAmount exceeds this value and then falls back to it,
+  \l drained() is emitted. Producers can stop sending while
+  \l bufferedAmount is above it. The default value is 0.
+  */
+
+/*!
+  \qmlproperty qint64 WebSocket::sendWindow
+  \since QtWebSocketsThreaded 1.2
+  When non-zero, the network thread hands messages to the socket only while
+  fewer than this many bytes are waiting to be written. The others wait in
+  one queue per priority given to \l postTextMessage(),
+  \l postBinaryMessage() or \l sendTextMessageUtf8(), so that small
+  WebSocket.HighPriority messages overtake earlier WebSocket.LowPriority
+  bulk. Frames of different messages can't interleave, so an urgent message
+  still waits for the end of the message being written: split large uploads
+  into several messages to bound that wait. The default value is 0, where
+  messages are handed over in order right away.
+  */
+
+/*!
+  \qmlsignal WebSocket::drained()
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted when \l bufferedAmount falls back to
+  \l highWaterMark after exceeding it.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::batchMessages
+  \since QtWebSocketsThreaded 1.2
+  When set to true, received messages are collected on the network thread and
+  delivered to the GUI thread at most once per event loop turn with
+  \l messagesReceived() instead of \l textMessageReceived() and
+  \l binaryMessageReceived().
+  The default value is false.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::parseJson
+  \since QtWebSocketsThreaded 1.2
+  When set to true, text messages are parsed as JSON on the network thread and
+  delivered with \l jsonMessageReceived() instead of \l textMessageReceived().
+  Messages that are not valid JSON are still delivered as text.
+  The default value is false.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::streamFrames
+  \since QtWebSocketsThreaded 1.2
+  When set to true, every frame is delivered with \l textFrameReceived() or
+  \l binaryFrameReceived() as soon as it arrives, and the assembled messages
+  are not delivered at all. Use it to process very large messages
+  incrementally. It doesn't apply while \l compression is offered or in use:
+  compressed messages can only be decompressed whole, so messages are then
+  delivered as usual.
+  The default value is false.
+  */
+
+/*!
+  \qmlproperty Transport WebSocket::transport
+  \since QtWebSocketsThreaded 1.2
+  How commands and received messages travel between the GUI thread and the
+  network thread:
+
+  \list
+  \li WebSocket.SignalTransport - one queued signal per command and per
+      message
+  \li WebSocket.RingTransport - a pair of lock-free rings, an event is only
+      posted when the receiving thread is idle. This saves the per-message
+      event allocations at high message rates
+  \endlist
+
+  It should be set before the socket is opened, messages that are in flight
+  while switching may be reordered.
+  The default value is WebSocket.SignalTransport.
+  */
+
+/*!
+  \qmlproperty TextEncoding WebSocket::textEncoding
+  \since QtWebSocketsThreaded 1.2
+  How received text messages are delivered:
+
+  \list
+  \li WebSocket.Utf16Text - as strings with \l textMessageReceived()
+  \li WebSocket.Utf8Text - as UTF-8 ArrayBuffers with
+      \l utf8TextMessageReceived(), converted on the network thread. With
+      \l compression the decompressed text is validated and delivered without
+      being decoded at all
+  \endlist
+
+  Routed messages and messages parsed with \l parseJson are not affected.
+  The default value is WebSocket.Utf16Text.
+  */
+
+/*!
+  \qmlproperty BinaryFormat WebSocket::binaryFormat
+  \since QtWebSocketsThreaded 1.2
+  How binary messages are encoded:
+
+  \list
+  \li WebSocket.RawBinary - not at all, they are ArrayBuffers
+  \li WebSocket.CborBinary - in CBOR, needs Qt 5.12
+  \li WebSocket.MessagePackBinary - in MessagePack
+  \endlist
+
+  With an encoding, received binary messages are decoded on the network
+  thread and delivered with \l decodedMessageReceived(), and
+  \l sendBinaryMessage() and \l postBinaryMessage() also take objects,
+  arrays, strings, numbers, booleans, dates and nulls,
+  encoded on the network thread. Messages that can't be decoded are still
+  delivered with \l binaryMessageReceived(). Routed messages, frames and
+  messages handled by the \l processorSource script are not affected.
+  Formats this Qt build doesn't support are refused with a warning and the
+  property keeps its value. The default value is WebSocket.RawBinary.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::compression
+  \since QtWebSocketsThreaded 1.2
+  When set to true, messages are compressed and decompressed on the network
+  thread with the DEFLATE scheme of RFC 7692 (raw deflate, the trailing
+  0x00 0x00 0xff 0xff of the sync flush stripped). QWebSocket can neither
+  negotiate the permessage-deflate extension nor send RSV1 frames, so
+  compressed messages are sent as binary frames whose first byte is 0x01 for
+  text and 0x02 for binary payloads, and the server has to implement this
+  framing. The offer goes out with the opening handshake in the
+  \c X-WebSocket-Compression header, for example
+  \c {deflate; window_bits=15; no_context_takeover}.
+
+  QWebSocket doesn't expose the handshake response, so the server accepts
+  the offer in band: its first message is the binary message made of a zero
+  byte followed by \c deflate, which the client echoes before its first
+  compressed message. Any other first message declines the offer, and the
+  connection stays uncompressed both ways. Until then messages are sent
+  plain. Once accepted, received binary messages starting with one of the
+  type bytes are decompressed. The connection is closed with code 1007 if
+  that fails, and with code 1009 if a message inflates beyond 64 MiB.
+
+  Changes apply from the next connection. The default value is false.
+  */
+
+/*!
+  \qmlproperty int WebSocket::compressionWindowBits
+  \since QtWebSocketsThreaded 1.2
+  Base-2 logarithm of the LZ77 window used to compress outgoing messages,
+  from 9 to 15. Smaller windows use less memory per socket at some cost in
+  compression ratio. The default value is 15.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::compressionContextTakeover
+  \since QtWebSocketsThreaded 1.2
+  When true, the compression context is kept between messages, which
+  compresses repetitive messages much better. When false, every message is
+  compressed and decompressed on its own, which saves memory.
+  The default value is true.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::autoReconnect
+  \since QtWebSocketsThreaded 1.2
+  When set to true, the network thread reconnects by itself whenever the
+  connection is lost or can't be established, until the socket is deactivated.
+  The attempts are paced by \l minBackoff, \l maxBackoff and \l jitter, and
+  the \l status changes are reported as usual.
+  The default value is false.
+  */
+
+/*!
+  \qmlproperty int WebSocket::minBackoff
+  \since QtWebSocketsThreaded 1.2
+  Delay before the first reconnect attempt, in milliseconds. It doubles with
+  every failed attempt up to \l maxBackoff. The default value is 1000.
+  */
+
+/*!
+  \qmlproperty int WebSocket::maxBackoff
+  \since QtWebSocketsThreaded 1.2
+  Upper limit of the delay between reconnect attempts, in milliseconds.
+  The default value is 30000.
+  */
+
+/*!
+  \qmlproperty real WebSocket::jitter
+  \since QtWebSocketsThreaded 1.2
+  Every reconnect delay is shortened by a random fraction of up to this
+  value, from 0 to 1, so that clients which lost the connection together
+  don't reconnect in lockstep. The default value is 0.5.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::replayMessages
+  \since QtWebSocketsThreaded 1.2
+  When set to true together with \l autoReconnect, messages that reach the
+  network thread while it is reconnecting are kept and sent once the
+  connection is back, instead of being dropped. Messages that were already
+  handed to the lost connection are not replayed. At most 65536 messages or
+  16 MB are kept, beyond that the oldest are dropped with a warning.
+  The default value is false.
+  */
+
+/*!
+  \qmlproperty list WebSocket::filters
+  \since QtWebSocketsThreaded 1.2
+  Rules deciding on the network thread which received messages are delivered,
+  so that unwanted messages cost nothing on the GUI thread. The first rule
+  matching a message decides, messages matching no rule are dropped, and an
+  empty list, the default, delivers everything. A rule is an object with any
+  of the following keys, an empty rule matches every message:
+
+  \list
+  \li \c prefix: the message starts with this string
+  \li \c path: dot separated path of a value in the JSON text message that
+      has to exist, numbers index arrays
+  \li \c value: the value at \c path is equal to this one
+  \li \c increasing: the value at \c path is a number greater than the last
+      one matched by this rule, which drops stale sequence numbers
+  \li \c route: the message is delivered with \l routedTextMessageReceived()
+      or \l routedBinaryMessageReceived() under this name instead
+  \li \c drop: matching messages are dropped
+  \endlist
+
+  \code
+  filters: [
+      { path: "type", value: "heartbeat", drop: true },
+      { path: "topic", value: "quotes", route: "quotes" },
+      { path: "seq", increasing: true }
+  ]
+  \endcode
+
+  Frames delivered with \l streamFrames are not filtered. The dropped messages
+  are counted in \c stats.messagesFiltered.
+  */
+
+/*!
+  \qmlproperty string WebSocket::conflationKey
+  \since QtWebSocketsThreaded 1.2
+  Dot separated path of a value in the JSON text messages, as in \l filters,
+  used as the key of the message for conflation. When set, the network thread
+  only keeps the latest message of every key and the GUI thread gets the
+  messages of the keys that changed since the last delivery, so the work and
+  the memory are bounded by the number of keys whatever the message rate.
+  Messages without that value are delivered as usual, possibly before the
+  conflated ones received earlier. Conflated messages are delivered together
+  with \l messagesReceived() when \l batchMessages is enabled.
+  The replaced messages are counted in \c stats.messagesConflated.
+  The default value is an empty string, which disables conflation.
+
+  \code
+  conflationKey: "symbol"
+  \endcode
+  */
+
+/*!
+  \qmlproperty url WebSocket::processorSource
+  \since QtWebSocketsThreaded 1.2
+  A JavaScript file run on the network thread, in its own engine, for every
+  received message that passed the \l filters and wasn't routed. Like in a
+  WorkerScript, the script sets \c WorkerScript.onMessage to a function
+  that gets the message as a string or an ArrayBuffer, and hands results to
+  \l processedMessageReceived() with \c WorkerScript.sendMessage(), or by
+  returning them. Messages it produces nothing for are dropped and counted in
+  \c stats.messagesFiltered, so it can aggregate messages, parse or decode
+  them, without any of that work happening on the GUI thread:
+
+  \code
+  // average.js
+  var sum = 0, count = 0
+  WorkerScript.onMessage = function(message) {
+      sum += JSON.parse(message).price
+      if (++count === 100) {
+          WorkerScript.sendMessage({ average: sum / count })
+          sum = count = 0
+      }
+  }
+  \endcode
+
+  The script has no access to QML types or to the objects of the GUI
+  thread. \l parseJson, \l conflationKey and \l textEncoding don't apply
+  to the processed messages. The default value is an empty url, which
+  delivers the messages as they are.
+  */
+
+/*!
+  \qmlproperty int WebSocket::frameBudget
+  \since QtWebSocketsThreaded 1.2
+  When greater than 0, received messages are delivered in step with the
+  rendering of \l window instead of as soon as they arrive: they are
+  dispatched when the window has finished animating a frame, for at most
+  \c frameBudget milliseconds per frame. The rest waits for the next frame,
+  which is requested right away, while the network thread keeps receiving.
+  With \l batchMessages, the messages of a frame come with one
+  \l messagesReceived() call.
+  While the window is not exposed, for example when it is minimized, hidden
+  or on another virtual desktop, it draws no frames and messages are
+  delivered right away, once per event loop iteration, until it is exposed
+  again.
+  The default value is 0, which delivers messages right away.
+
+  \code
+  frameBudget: 4
+  \endcode
+  */
+
+/*!
+  \qmlproperty Window WebSocket::window
+  \since QtWebSocketsThreaded 1.2
+  The window \l frameBudget paces the delivery to. Defaults to the window of
+  the closest Item the WebSocket is declared in. Without a window, messages
+  are delivered right away.
+  */
+
+/*!
+  \qmlproperty int WebSocket::pingInterval
+  \since QtWebSocketsThreaded 1.2
+  When non-zero, the network thread pings the server every this many
+  milliseconds while connected, even when the GUI thread is blocked. A
+  connection that doesn't answer within \l pongTimeout is aborted with an
+  error, and reconnected when \l autoReconnect is set. Every pong updates
+  \l roundTripTime. The default value is 0.
+  */
+
+/*!
+  \qmlproperty int WebSocket::pongTimeout
+  \since QtWebSocketsThreaded 1.2
+  How long to wait for the pong of a keepalive ping sent every
+  \l pingInterval, in milliseconds, 0 waits forever.
+  The default value is 10000.
+  */
+
+/*!
+  \qmlproperty bool WebSocket::coalesceSends
+  \since QtWebSocketsThreaded 1.2
+  When set, the network thread holds the messages sent within one of its
+  event loop turns, or within \l coalesceDelay of the first one, and writes
+  them to the socket together. A handler sending many small messages in a
+  loop then costs a few writes, and few TLS records on secure connections,
+  rather than one per message. The messages stay separate WebSocket messages
+  and keep their order. The default value is false.
+  */
+
+/*!
+  \qmlproperty int WebSocket::coalesceDelay
+  \since QtWebSocketsThreaded 1.2
+  How long \l coalesceSends holds the first message of a batch, in
+  milliseconds, for the rest of the burst to catch up. 0, the default,
+  only waits for the end of the current event loop turn of the network
+  thread. Every held message is delayed by up to this much.
+  */
+
+/*!
+  \qmlproperty real WebSocket::roundTripTime
+  \since QtWebSocketsThreaded 1.2
+  The round trip time of the keepalive pings in milliseconds, smoothed over
+  their pongs on the current connection like TCP does it (RFC 6298), or -1
+  before the first one. Other pongs, such as unsolicited ones, are not
+  taken into account.
+  */
+
+/*!
+  \qmlproperty real WebSocket::roundTripTimeVariation
+  \since QtWebSocketsThreaded 1.2
+  The jitter of \l roundTripTime: the smoothed mean deviation of the round
+  trips from it, in milliseconds, or -1 before the first pong.
+  */
+
+/*!
+  \qmlproperty WebSocketStats WebSocket::stats
+  \since QtWebSocketsThreaded 1.2
+  Counters of the socket, always collected: \c messagesReceived,
+  \c bytesReceived, \c messagesSent, \c bytesSent, \c messagesFiltered,
+  \c messagesConflated, the number of messages
+  waiting for the GUI thread (\c queueDepth and \c maxQueueDepth),
+  \c reconnectCount, and the time from the arrival on the network thread to
+  the dispatch on the GUI thread in microseconds (\c dispatchLatencyP50,
+  \c dispatchLatencyP99 and \c dispatchLatencyHistogram, where the entry
+  \e i counts the delays below 2^\e i us). \c bytesReceived and \c bytesSent
+  count bytes on the wire, frame headers included, so text counts in UTF-8.
+
+  The properties notify with \c updated(), which is emitted by
+  \c update() or every \c updateInterval milliseconds when that is
+  non-zero:
+
+  \code
+  Text { text: socket.stats.queueDepth }
+  Component.onCompleted: socket.stats.updateInterval = 1000
+  \endcode
+  */
+
 /*!
   \qmlsignal WebSocket::textMessageReceived(QString message)
   This signal is emitted when a text message is received.
@@ -94,6 +494,83 @@
   \qmlsignal WebSocket::binaryMessageReceived(QString message)
   \since 5.8
   This signal is emitted when a binary message is received.
+  The message is passed as an ArrayBuffer sharing the storage of the received
+  buffer, it is not copied on the way from the network thread.
+  */
+
+/*!
+  \qmlsignal WebSocket::jsonMessageReceived(var message)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted with the already parsed message when a text message is
+  received and \l parseJson is enabled.
+  */
+
+/*!
+  \qmlsignal WebSocket::textFrameReceived(QString frame, bool isLastFrame)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted for every frame of a text message when
+  \l streamFrames is enabled. \a isLastFrame is true for the frame completing
+  the message.
+  */
+
+/*!
+  \qmlsignal WebSocket::binaryFrameReceived(ArrayBuffer frame, bool isLastFrame)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted for every frame of a binary message when
+  \l streamFrames is enabled. \a isLastFrame is true for the frame completing
+  the message.
+  */
+
+/*!
+  \qmlsignal WebSocket::messagesReceived(list messages)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted with all the messages received since the last time it
+  was emitted, in order, when \l batchMessages is enabled. Every entry is an
+  object with the message in \c data and how it was delivered in \c type:
+
+  \list
+  \li \c "text" - a string
+  \li \c "utf8Text" - an ArrayBuffer holding UTF-8 text, with \l textEncoding
+  \li \c "binary" - an ArrayBuffer
+  \li \c "json" - the value parsed with \l parseJson. Text messages that are
+      not valid JSON stay \c "text".
+  \li \c "decoded" - the value decoded with \l binaryFormat
+  \li \c "processed" - a value produced by the \l processorSource script
+  \endlist
+  */
+
+/*!
+  \qmlsignal WebSocket::processedMessageReceived(var message)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted with every value produced by the \l processorSource
+  script, instead of the signals of the messages it processed.
+  */
+
+/*!
+  \qmlsignal WebSocket::decodedMessageReceived(var message)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted instead of \l binaryMessageReceived() with the
+  decoded value of the binary messages, see \l binaryFormat.
+  */
+
+/*!
+  \qmlsignal WebSocket::routedTextMessageReceived(string route, string message)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted instead of \l textMessageReceived() for the text
+  messages matched by a rule of \l filters with a \c route.
+  */
+
+/*!
+  \qmlsignal WebSocket::routedBinaryMessageReceived(string route, ArrayBuffer message)
+  \since QtWebSocketsThreaded 1.2
+  Binary counterpart of \l routedTextMessageReceived().
+  */
+
+/*!
+  \qmlsignal WebSocket::utf8TextMessageReceived(ArrayBuffer message)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted instead of \l textMessageReceived() when
+  \l textEncoding is WebSocket.Utf8Text, with the UTF-8 encoded message.
   */
 
 /*!
@@ -112,7 +589,43 @@
 /*!
   \qmlmethod void WebSocket::sendBinaryMessage(ArrayBuffer message)
   \since 5.8
-  Sends \c message to the server.
+  Sends \c message to the server. With a \l binaryFormat, \c message can
+  also be a value that is encoded on the network thread.
+  */
+
+/*!
+  \qmlmethod int WebSocket::postTextMessage(string message, Priority priority)
+  \since QtWebSocketsThreaded 1.2
+  Sends \c message to the server like \l sendTextMessage() and returns an id
+  right away, without waiting for the network thread. The same id is passed to
+  \l messageSent() once the message has been written to the network.
+  \a priority is one of WebSocket.HighPriority, WebSocket.NormalPriority
+  (the default) and WebSocket.LowPriority, see \l sendWindow.
+  Returns 0 if the socket is not open.
+  */
+
+/*!
+  \qmlmethod int WebSocket::postBinaryMessage(ArrayBuffer message, Priority priority)
+  \since QtWebSocketsThreaded 1.2
+  Binary counterpart of \l postTextMessage().
+  */
+
+/*!
+  \qmlmethod int WebSocket::sendTextMessageUtf8(ArrayBuffer message, Priority priority)
+  \since QtWebSocketsThreaded 1.2
+  Sends the UTF-8 encoded \c message to the server as a text message. With
+  \l compression it is compressed without ever being decoded.
+  */
+
+/*!
+  \qmlsignal WebSocket::messageSent(int messageId, int bytes)
+  \since QtWebSocketsThreaded 1.2
+  This signal is emitted on the GUI thread once the message posted with
+  \l postTextMessage() or \l postBinaryMessage() has been written to the
+  network, that is once \l bufferedAmount no longer includes it. \a bytes is
+  the payload size as returned by the socket, text is counted after the
+  conversion to UTF-8. It is not emitted for messages dropped because the
+  connection closed before they were written.
   */
 
 #include "qqmlwebsocketthreaded.h"
@@ -120,6 +633,30 @@
 
 QT_BEGIN_NAMESPACE
 
+// JavaScript objects arrive wrapped in QJSValue, which only the GUI thread
+// can read
+static QVariant toEncodable(const QVariant &value)
+{
+    if (value.userType() == qMetaTypeId<QJSValue>()) {
+        return value.value<QJSValue>().toVariant();
+    }
+    if (value.userType() == QMetaType::QVariantList) {
+        QVariantList list = value.toList();
+        for (QVariant &element : list) {
+            element = toEncodable(element);
+        }
+        return list;
+    }
+    if (value.userType() == QMetaType::QVariantMap) {
+        QVariantMap map = value.toMap();
+        for (QVariantMap::iterator it = map.begin(); it != map.end(); ++it) {
+            it.value() = toEncodable(it.value());
+        }
+        return map;
+    }
+    return value;
+}
+
 QQmlWebSocketThreaded::QQmlWebSocketThreaded(QObject *parent) :
     QObject(parent),
     m_webSocket(),
@@ -127,7 +664,35 @@ QQmlWebSocketThreaded::QQmlWebSocketThreaded(QObject *parent) :
     m_url(),
     m_isActive(false),
     m_componentCompleted(true),
-    m_errorString()
+    m_errorString(),
+    m_highWaterMark(0),
+    m_sendWindow(0),
+    m_batchMessages(false),
+    m_parseJson(false),
+    m_streamFrames(false),
+    m_transport(SignalTransport),
+    m_compression(false),
+    m_compressionWindowBits(15),
+    m_compressionContextTakeover(true),
+    m_autoReconnect(false),
+    m_minBackoff(1000),
+    m_maxBackoff(30000),
+    m_jitter(0.5),
+    m_replayMessages(false),
+    m_filters(),
+    m_conflationKey(),
+    m_processorSource(),
+    m_processor(),
+    m_frameBudget(0),
+    m_window(),
+    m_textEncoding(Utf16Text),
+    m_item(),
+    m_pacingWindow(),
+    m_pingInterval(0),
+    m_pongTimeout(10000),
+    m_coalesceSends(false),
+    m_coalesceDelay(0),
+    m_binaryFormat(RawBinary)
 {
 }
 
@@ -137,7 +702,35 @@ QQmlWebSocketThreaded::QQmlWebSocketThreaded(QWebSocketThreaded *socket, QObject
     m_url(socket->requestUrl()),
     m_isActive(true),
     m_componentCompleted(true),
-    m_errorString(socket->errorString())
+    m_errorString(socket->errorString()),
+    m_highWaterMark(socket->highWaterMark()),
+    m_sendWindow(socket->sendWindow()),
+    m_batchMessages(socket->batchMessages()),
+    m_parseJson(socket->parseJson()),
+    m_streamFrames(socket->streamFrames()),
+    m_transport(static_cast<Transport>(socket->transport())),
+    m_compression(socket->compression()),
+    m_compressionWindowBits(socket->compressionWindowBits()),
+    m_compressionContextTakeover(socket->compressionContextTakeover()),
+    m_autoReconnect(socket->autoReconnect()),
+    m_minBackoff(socket->minBackoff()),
+    m_maxBackoff(socket->maxBackoff()),
+    m_jitter(socket->jitter()),
+    m_replayMessages(socket->replayMessages()),
+    m_filters(),
+    m_conflationKey(),
+    m_processorSource(),
+    m_processor(),
+    m_frameBudget(0),
+    m_window(),
+    m_textEncoding(static_cast<TextEncoding>(socket->textEncoding())),
+    m_item(),
+    m_pacingWindow(),
+    m_pingInterval(socket->pingInterval()),
+    m_pongTimeout(socket->pongTimeout()),
+    m_coalesceSends(socket->coalesceSends()),
+    m_coalesceDelay(socket->coalesceDelay()),
+    m_binaryFormat(static_cast<BinaryFormat>(socket->binaryFormat()))
 {
     setSocket(socket);
     onStateChanged(socket->state());
@@ -157,14 +750,52 @@ qint64 QQmlWebSocketThreaded::sendTextMessage(const QString &message)
     return m_webSocket->sendTextMessage(message);
 }
 
-qint64 QQmlWebSocketThreaded::sendBinaryMessage(const QByteArray &message)
+qint64 QQmlWebSocketThreaded::sendBinaryMessage(const QVariant &message)
+{
+    if (m_status != Open) {
+        setErrorString(tr("Messages can only be sent when the socket is open."));
+        setStatus(Error);
+        return 0;
+    }
+    if (m_binaryFormat == RawBinary || message.userType() == QMetaType::QByteArray) {
+        return m_webSocket->sendBinaryMessage(message.toByteArray());
+    }
+    return m_webSocket->sendEncodedMessage(toEncodable(message));
+}
+
+qint64 QQmlWebSocketThreaded::postTextMessage(const QString &message, Priority priority)
+{
+    if (m_status != Open) {
+        setErrorString(tr("Messages can only be sent when the socket is open."));
+        setStatus(Error);
+        return 0;
+    }
+    return m_webSocket->postTextMessage(message, static_cast<QWebSocketThreaded::Priority>(priority));
+}
+
+qint64 QQmlWebSocketThreaded::postBinaryMessage(const QVariant &message, Priority priority)
 {
     if (m_status != Open) {
         setErrorString(tr("Messages can only be sent when the socket is open."));
         setStatus(Error);
         return 0;
     }
-    return m_webSocket->sendBinaryMessage(message);
+    if (m_binaryFormat == RawBinary || message.userType() == QMetaType::QByteArray) {
+        return m_webSocket->postBinaryMessage(message.toByteArray(),
+                                              static_cast<QWebSocketThreaded::Priority>(priority));
+    }
+    return m_webSocket->postEncodedMessage(toEncodable(message),
+                                           static_cast<QWebSocketThreaded::Priority>(priority));
+}
+
+qint64 QQmlWebSocketThreaded::sendTextMessageUtf8(const QByteArray &message, Priority priority)
+{
+    if (m_status != Open) {
+        setErrorString(tr("Messages can only be sent when the socket is open."));
+        setStatus(Error);
+        return 0;
+    }
+    return m_webSocket->sendTextMessageUtf8(message, static_cast<QWebSocketThreaded::Priority>(priority));
 }
 
 QUrl QQmlWebSocketThreaded::url() const
@@ -208,6 +839,17 @@ void QQmlWebSocketThreaded::componentComplete()
 
     m_componentCompleted = true;
 
+    for (QObject *object = parent(); object; object = object->parent()) {
+        m_item = qobject_cast<QQuickItem *>(object);
+        if (m_item) {
+            // Items usually get their window after their children complete
+            connect(m_item.data(), &QQuickItem::windowChanged,
+                    this, &QQmlWebSocketThreaded::updatePacing);
+            break;
+        }
+    }
+    updatePacing();
+
     open();
 }
 
@@ -217,16 +859,81 @@ void QQmlWebSocketThreaded::setSocket(QWebSocketThreaded *socket)
     if (m_webSocket) {
         // explicit ownership via QScopedPointer
         m_webSocket->setParent(Q_NULLPTR);
+        m_webSocket->setHighWaterMark(m_highWaterMark);
+        m_webSocket->setSendWindow(m_sendWindow);
+        m_webSocket->setBatchMessages(m_batchMessages);
+        m_webSocket->setParseJson(m_parseJson);
+        m_webSocket->setStreamFrames(m_streamFrames);
+        m_webSocket->setTransport(static_cast<QWebSocketThreaded::Transport>(m_transport));
+        m_webSocket->setCompression(m_compression);
+        m_webSocket->setCompressionWindowBits(m_compressionWindowBits);
+        m_webSocket->setCompressionContextTakeover(m_compressionContextTakeover);
+        m_webSocket->setAutoReconnect(m_autoReconnect);
+        m_webSocket->setMinBackoff(m_minBackoff);
+        m_webSocket->setMaxBackoff(m_maxBackoff);
+        m_webSocket->setJitter(m_jitter);
+        m_webSocket->setReplayMessages(m_replayMessages);
+        m_webSocket->setTextEncoding(static_cast<QWebSocketThreaded::TextEncoding>(m_textEncoding));
+        m_webSocket->setBinaryFormat(static_cast<QWebSocketThreaded::BinaryFormat>(m_binaryFormat));
+        // Formats this Qt build doesn't support are refused
+        if (m_binaryFormat != static_cast<BinaryFormat>(m_webSocket->binaryFormat())) {
+            m_binaryFormat = static_cast<BinaryFormat>(m_webSocket->binaryFormat());
+            Q_EMIT binaryFormatChanged(m_binaryFormat);
+        }
+        if (!m_filters.isEmpty()) {
+            m_webSocket->setFilter(QSharedPointer<QWebSocketThreadedFilter>(
+                                       new QWebSocketThreadedMatchFilter(m_filters)));
+        }
+        if (!m_conflationKey.isEmpty()) {
+            m_webSocket->setKeyExtractor(QSharedPointer<QWebSocketThreadedKeyExtractor>(
+                                             new QWebSocketThreadedJsonKeyExtractor(m_conflationKey)));
+        }
+        updateProcessor();
+        m_webSocket->setPingInterval(m_pingInterval);
+        m_webSocket->setPongTimeout(m_pongTimeout);
+        m_webSocket->setCoalesceSends(m_coalesceSends);
+        m_webSocket->setCoalesceDelay(m_coalesceDelay);
         connect(m_webSocket.data(), &QWebSocketThreaded::textMessageReceived,
                 this, &QQmlWebSocketThreaded::textMessageReceived);
         connect(m_webSocket.data(), &QWebSocketThreaded::binaryMessageReceived,
                 this, &QQmlWebSocketThreaded::binaryMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::utf8TextMessageReceived,
+                this, &QQmlWebSocketThreaded::utf8TextMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::jsonMessageReceived,
+                this, &QQmlWebSocketThreaded::jsonMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::textFrameReceived,
+                this, &QQmlWebSocketThreaded::textFrameReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::binaryFrameReceived,
+                this, &QQmlWebSocketThreaded::binaryFrameReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::messagesReceived,
+                this, &QQmlWebSocketThreaded::messagesReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::processedMessageReceived,
+                this, &QQmlWebSocketThreaded::processedMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::decodedMessageReceived,
+                this, &QQmlWebSocketThreaded::decodedMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::messagesPending,
+                this, &QQmlWebSocketThreaded::onMessagesPending);
+        connect(m_webSocket.data(), &QWebSocketThreaded::connectionInfoChanged,
+                this, &QQmlWebSocketThreaded::onConnectionInfoChanged);
+        // Only routes produce channel messages, the socket is never multiplexed
+        connect(m_webSocket.data(), &QWebSocketThreaded::channelTextMessageReceived,
+                this, &QQmlWebSocketThreaded::routedTextMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::channelBinaryMessageReceived,
+                this, &QQmlWebSocketThreaded::routedBinaryMessageReceived);
+        connect(m_webSocket.data(), &QWebSocketThreaded::bufferedAmountChanged,
+                this, &QQmlWebSocketThreaded::bufferedAmountChanged);
+        connect(m_webSocket.data(), &QWebSocketThreaded::drained,
+                this, &QQmlWebSocketThreaded::drained);
+        connect(m_webSocket.data(), &QWebSocketThreaded::messageSent,
+                this, &QQmlWebSocketThreaded::messageSent);
         typedef void (QWebSocketThreaded::* ErrorSignal)(QAbstractSocket::SocketError);
         connect(m_webSocket.data(), static_cast<ErrorSignal>(&QWebSocketThreaded::error),
                 this, &QQmlWebSocketThreaded::onError);
         connect(m_webSocket.data(), &QWebSocketThreaded::stateChanged,
                 this, &QQmlWebSocketThreaded::onStateChanged);
+        updatePacing();
     }
+    Q_EMIT statsChanged();
 }
 
 void QQmlWebSocketThreaded::onError(QAbstractSocket::SocketError error)
@@ -304,6 +1011,569 @@ bool QQmlWebSocketThreaded::isActive() const
     return m_isActive;
 }
 
+qint64 QQmlWebSocketThreaded::bufferedAmount() const
+{
+    return m_webSocket ? m_webSocket->bufferedAmount() : 0;
+}
+
+qint64 QQmlWebSocketThreaded::highWaterMark() const
+{
+    return m_highWaterMark;
+}
+
+void QQmlWebSocketThreaded::setHighWaterMark(qint64 highWaterMark)
+{
+    highWaterMark = qMax<qint64>(0, highWaterMark);
+    if (m_highWaterMark == highWaterMark) {
+        return;
+    }
+    m_highWaterMark = highWaterMark;
+    if (m_webSocket) {
+        m_webSocket->setHighWaterMark(highWaterMark);
+    }
+    Q_EMIT highWaterMarkChanged(m_highWaterMark);
+}
+
+qint64 QQmlWebSocketThreaded::sendWindow() const
+{
+    return m_sendWindow;
+}
+
+void QQmlWebSocketThreaded::setSendWindow(qint64 sendWindow)
+{
+    sendWindow = qMax<qint64>(0, sendWindow);
+    if (m_sendWindow == sendWindow) {
+        return;
+    }
+    m_sendWindow = sendWindow;
+    if (m_webSocket) {
+        m_webSocket->setSendWindow(sendWindow);
+    }
+    Q_EMIT sendWindowChanged(m_sendWindow);
+}
+
+bool QQmlWebSocketThreaded::batchMessages() const
+{
+    return m_batchMessages;
+}
+
+void QQmlWebSocketThreaded::setBatchMessages(bool batchMessages)
+{
+    if (m_batchMessages == batchMessages) {
+        return;
+    }
+    m_batchMessages = batchMessages;
+    if (m_webSocket) {
+        m_webSocket->setBatchMessages(batchMessages);
+    }
+    Q_EMIT batchMessagesChanged(m_batchMessages);
+}
+
+bool QQmlWebSocketThreaded::parseJson() const
+{
+    return m_parseJson;
+}
+
+void QQmlWebSocketThreaded::setParseJson(bool parseJson)
+{
+    if (m_parseJson == parseJson) {
+        return;
+    }
+    m_parseJson = parseJson;
+    if (m_webSocket) {
+        m_webSocket->setParseJson(parseJson);
+    }
+    Q_EMIT parseJsonChanged(m_parseJson);
+}
+
+bool QQmlWebSocketThreaded::streamFrames() const
+{
+    return m_streamFrames;
+}
+
+void QQmlWebSocketThreaded::setStreamFrames(bool streamFrames)
+{
+    if (m_streamFrames == streamFrames) {
+        return;
+    }
+    m_streamFrames = streamFrames;
+    if (m_webSocket) {
+        m_webSocket->setStreamFrames(streamFrames);
+    }
+    Q_EMIT streamFramesChanged(m_streamFrames);
+}
+
+QQmlWebSocketThreaded::Transport QQmlWebSocketThreaded::transport() const
+{
+    return m_transport;
+}
+
+void QQmlWebSocketThreaded::setTransport(Transport transport)
+{
+    if (m_transport == transport) {
+        return;
+    }
+    m_transport = transport;
+    if (m_webSocket) {
+        m_webSocket->setTransport(static_cast<QWebSocketThreaded::Transport>(transport));
+    }
+    Q_EMIT transportChanged(m_transport);
+}
+
+QQmlWebSocketThreaded::TextEncoding QQmlWebSocketThreaded::textEncoding() const
+{
+    return m_textEncoding;
+}
+
+void QQmlWebSocketThreaded::setTextEncoding(TextEncoding textEncoding)
+{
+    if (m_textEncoding == textEncoding) {
+        return;
+    }
+    m_textEncoding = textEncoding;
+    if (m_webSocket) {
+        m_webSocket->setTextEncoding(static_cast<QWebSocketThreaded::TextEncoding>(textEncoding));
+    }
+    Q_EMIT textEncodingChanged(m_textEncoding);
+}
+
+QQmlWebSocketThreaded::BinaryFormat QQmlWebSocketThreaded::binaryFormat() const
+{
+    return m_binaryFormat;
+}
+
+void QQmlWebSocketThreaded::setBinaryFormat(BinaryFormat binaryFormat)
+{
+    if (m_binaryFormat == binaryFormat) {
+        return;
+    }
+    if (m_webSocket) {
+        // Formats this Qt build doesn't support are refused
+        m_webSocket->setBinaryFormat(static_cast<QWebSocketThreaded::BinaryFormat>(binaryFormat));
+        binaryFormat = static_cast<BinaryFormat>(m_webSocket->binaryFormat());
+        if (m_binaryFormat == binaryFormat) {
+            return;
+        }
+    }
+    m_binaryFormat = binaryFormat;
+    Q_EMIT binaryFormatChanged(m_binaryFormat);
+}
+
+bool QQmlWebSocketThreaded::compression() const
+{
+    return m_compression;
+}
+
+void QQmlWebSocketThreaded::setCompression(bool compression)
+{
+    if (m_compression == compression) {
+        return;
+    }
+    m_compression = compression;
+    if (m_webSocket) {
+        m_webSocket->setCompression(compression);
+    }
+    Q_EMIT compressionChanged(m_compression);
+}
+
+int QQmlWebSocketThreaded::compressionWindowBits() const
+{
+    return m_compressionWindowBits;
+}
+
+void QQmlWebSocketThreaded::setCompressionWindowBits(int compressionWindowBits)
+{
+    if (m_compressionWindowBits == compressionWindowBits) {
+        return;
+    }
+    m_compressionWindowBits = compressionWindowBits;
+    if (m_webSocket) {
+        m_webSocket->setCompressionWindowBits(compressionWindowBits);
+    }
+    Q_EMIT compressionWindowBitsChanged(m_compressionWindowBits);
+}
+
+bool QQmlWebSocketThreaded::compressionContextTakeover() const
+{
+    return m_compressionContextTakeover;
+}
+
+void QQmlWebSocketThreaded::setCompressionContextTakeover(bool contextTakeover)
+{
+    if (m_compressionContextTakeover == contextTakeover) {
+        return;
+    }
+    m_compressionContextTakeover = contextTakeover;
+    if (m_webSocket) {
+        m_webSocket->setCompressionContextTakeover(contextTakeover);
+    }
+    Q_EMIT compressionContextTakeoverChanged(m_compressionContextTakeover);
+}
+
+bool QQmlWebSocketThreaded::autoReconnect() const
+{
+    return m_autoReconnect;
+}
+
+void QQmlWebSocketThreaded::setAutoReconnect(bool autoReconnect)
+{
+    if (m_autoReconnect == autoReconnect) {
+        return;
+    }
+    m_autoReconnect = autoReconnect;
+    if (m_webSocket) {
+        m_webSocket->setAutoReconnect(autoReconnect);
+    }
+    Q_EMIT autoReconnectChanged(m_autoReconnect);
+}
+
+int QQmlWebSocketThreaded::minBackoff() const
+{
+    return m_minBackoff;
+}
+
+void QQmlWebSocketThreaded::setMinBackoff(int minBackoff)
+{
+    if (m_minBackoff == minBackoff) {
+        return;
+    }
+    m_minBackoff = minBackoff;
+    if (m_webSocket) {
+        m_webSocket->setMinBackoff(minBackoff);
+    }
+    Q_EMIT minBackoffChanged(m_minBackoff);
+}
+
+int QQmlWebSocketThreaded::maxBackoff() const
+{
+    return m_maxBackoff;
+}
+
+void QQmlWebSocketThreaded::setMaxBackoff(int maxBackoff)
+{
+    if (m_maxBackoff == maxBackoff) {
+        return;
+    }
+    m_maxBackoff = maxBackoff;
+    if (m_webSocket) {
+        m_webSocket->setMaxBackoff(maxBackoff);
+    }
+    Q_EMIT maxBackoffChanged(m_maxBackoff);
+}
+
+double QQmlWebSocketThreaded::jitter() const
+{
+    return m_jitter;
+}
+
+void QQmlWebSocketThreaded::setJitter(double jitter)
+{
+    if (qFuzzyCompare(m_jitter, jitter)) {
+        return;
+    }
+    m_jitter = jitter;
+    if (m_webSocket) {
+        m_webSocket->setJitter(jitter);
+    }
+    Q_EMIT jitterChanged(m_jitter);
+}
+
+bool QQmlWebSocketThreaded::replayMessages() const
+{
+    return m_replayMessages;
+}
+
+void QQmlWebSocketThreaded::setReplayMessages(bool replayMessages)
+{
+    if (m_replayMessages == replayMessages) {
+        return;
+    }
+    m_replayMessages = replayMessages;
+    if (m_webSocket) {
+        m_webSocket->setReplayMessages(replayMessages);
+    }
+    Q_EMIT replayMessagesChanged(m_replayMessages);
+}
+
+QVariantList QQmlWebSocketThreaded::filters() const
+{
+    return m_filters;
+}
+
+void QQmlWebSocketThreaded::setFilters(const QVariantList &filters)
+{
+    if (m_filters == filters) {
+        return;
+    }
+    m_filters = filters;
+    if (m_webSocket) {
+        // A new filter, the state of increasing rules starts over
+        m_webSocket->setFilter(m_filters.isEmpty()
+                               ? QSharedPointer<QWebSocketThreadedFilter>()
+                               : QSharedPointer<QWebSocketThreadedFilter>(
+                                     new QWebSocketThreadedMatchFilter(m_filters)));
+    }
+    Q_EMIT filtersChanged(m_filters);
+}
+
+QString QQmlWebSocketThreaded::conflationKey() const
+{
+    return m_conflationKey;
+}
+
+void QQmlWebSocketThreaded::setConflationKey(const QString &conflationKey)
+{
+    if (m_conflationKey == conflationKey) {
+        return;
+    }
+    m_conflationKey = conflationKey;
+    if (m_webSocket) {
+        m_webSocket->setKeyExtractor(m_conflationKey.isEmpty()
+                                     ? QSharedPointer<QWebSocketThreadedKeyExtractor>()
+                                     : QSharedPointer<QWebSocketThreadedKeyExtractor>(
+                                           new QWebSocketThreadedJsonKeyExtractor(m_conflationKey)));
+    }
+    Q_EMIT conflationKeyChanged(m_conflationKey);
+}
+
+QUrl QQmlWebSocketThreaded::processorSource() const
+{
+    return m_processorSource;
+}
+
+void QQmlWebSocketThreaded::setProcessorSource(const QUrl &processorSource)
+{
+    if (m_processorSource == processorSource) {
+        return;
+    }
+    m_processorSource = processorSource;
+    if (m_webSocket) {
+        updateProcessor();
+    }
+    Q_EMIT processorSourceChanged(m_processorSource);
+}
+
+QSharedPointer<QWebSocketThreadedProcessor> QQmlWebSocketThreaded::processor() const
+{
+    return m_processor;
+}
+
+void QQmlWebSocketThreaded::setProcessor(const QSharedPointer<QWebSocketThreadedProcessor> &processor)
+{
+    if (m_processor == processor) {
+        return;
+    }
+    m_processor = processor;
+    if (m_webSocket) {
+        updateProcessor();
+    }
+}
+
+void QQmlWebSocketThreaded::updateProcessor()
+{
+    if (m_processor) {
+        m_webSocket->setProcessor(m_processor);
+        return;
+    }
+    if (m_processorSource.isEmpty()) {
+        m_webSocket->setProcessor(QSharedPointer<QWebSocketThreadedProcessor>());
+        return;
+    }
+    // Relative to the QML file, like WorkerScript.source
+    const QQmlContext *context = qmlContext(this);
+    const QUrl source = context ? context->resolvedUrl(m_processorSource) : m_processorSource;
+    m_webSocket->setProcessor(QSharedPointer<QWebSocketThreadedProcessor>(
+                                  new QWebSocketThreadedScriptProcessor(source)));
+}
+
+int QQmlWebSocketThreaded::frameBudget() const
+{
+    return m_frameBudget;
+}
+
+void QQmlWebSocketThreaded::setFrameBudget(int frameBudget)
+{
+    frameBudget = qMax(0, frameBudget);
+    if (m_frameBudget == frameBudget) {
+        return;
+    }
+    m_frameBudget = frameBudget;
+    updatePacing();
+    Q_EMIT frameBudgetChanged(m_frameBudget);
+}
+
+QQuickWindow *QQmlWebSocketThreaded::window() const
+{
+    return m_pacingWindow;
+}
+
+void QQmlWebSocketThreaded::setWindow(QQuickWindow *window)
+{
+    if (m_window == window) {
+        return;
+    }
+    m_window = window;
+    updatePacing();
+}
+
+void QQmlWebSocketThreaded::updatePacing()
+{
+    QQuickWindow *window = m_window ? m_window.data() : m_item ? m_item->window() : Q_NULLPTR;
+    if (m_pacingWindow != window) {
+        if (m_pacingWindow) {
+            disconnect(m_pacingWindow.data(), &QQuickWindow::afterAnimating,
+                       this, &QQmlWebSocketThreaded::onAfterAnimating);
+            disconnect(m_pacingWindow.data(), &QWindow::visibilityChanged,
+                       this, &QQmlWebSocketThreaded::updatePacing);
+            m_pacingWindow->removeEventFilter(this);
+        }
+        m_pacingWindow = window;
+        if (m_pacingWindow) {
+            // Emitted on the GUI thread, unlike beforeSynchronizing with the
+            // threaded render loop
+            connect(m_pacingWindow.data(), &QQuickWindow::afterAnimating,
+                    this, &QQmlWebSocketThreaded::onAfterAnimating);
+            // A window that isn't exposed draws no frames, so there is
+            // nothing to pace to until it is again
+            connect(m_pacingWindow.data(), &QWindow::visibilityChanged,
+                    this, &QQmlWebSocketThreaded::updatePacing);
+            m_pacingWindow->installEventFilter(this);
+        }
+        Q_EMIT windowChanged(m_pacingWindow);
+    }
+    if (!m_webSocket) {
+        return;
+    }
+    const bool paced = m_frameBudget > 0 && m_pacingWindow && m_pacingWindow->isExposed();
+    m_webSocket->setPaced(paced);
+    if (paced) {
+        // Whatever was queued before has to wait for a frame too
+        m_pacingWindow->update();
+    }
+}
+
+bool QQmlWebSocketThreaded::eventFilter(QObject *watched, QEvent *event)
+{
+    // Not every change of exposure comes with visibilityChanged(), an
+    // occluded window or one on another virtual desktop stays visible
+    if (watched == m_pacingWindow && event->type() == QEvent::Expose) {
+        QMetaObject::invokeMethod(this, "updatePacing", Qt::QueuedConnection);
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void QQmlWebSocketThreaded::onConnectionInfoChanged()
+{
+    Q_EMIT roundTripTimeChanged();
+}
+
+void QQmlWebSocketThreaded::onMessagesPending()
+{
+    if (m_pacingWindow) {
+        m_pacingWindow->update();
+    }
+}
+
+void QQmlWebSocketThreaded::onAfterAnimating()
+{
+    if (!m_webSocket || !m_webSocket->paced()) {
+        return;
+    }
+    if (m_webSocket->dispatchPending(qint64(m_frameBudget) * 1000000)) {
+        // The rest goes with the next frame, which has to come even if
+        // nothing else changes
+        if (m_pacingWindow) {
+            m_pacingWindow->update();
+        }
+    }
+}
+
+int QQmlWebSocketThreaded::pingInterval() const
+{
+    return m_pingInterval;
+}
+
+void QQmlWebSocketThreaded::setPingInterval(int pingInterval)
+{
+    if (m_pingInterval == pingInterval) {
+        return;
+    }
+    m_pingInterval = pingInterval;
+    if (m_webSocket) {
+        m_webSocket->setPingInterval(pingInterval);
+    }
+    Q_EMIT pingIntervalChanged(m_pingInterval);
+}
+
+int QQmlWebSocketThreaded::pongTimeout() const
+{
+    return m_pongTimeout;
+}
+
+void QQmlWebSocketThreaded::setPongTimeout(int pongTimeout)
+{
+    if (m_pongTimeout == pongTimeout) {
+        return;
+    }
+    m_pongTimeout = pongTimeout;
+    if (m_webSocket) {
+        m_webSocket->setPongTimeout(pongTimeout);
+    }
+    Q_EMIT pongTimeoutChanged(m_pongTimeout);
+}
+
+bool QQmlWebSocketThreaded::coalesceSends() const
+{
+    return m_coalesceSends;
+}
+
+void QQmlWebSocketThreaded::setCoalesceSends(bool coalesceSends)
+{
+    if (m_coalesceSends == coalesceSends) {
+        return;
+    }
+    m_coalesceSends = coalesceSends;
+    if (m_webSocket) {
+        m_webSocket->setCoalesceSends(coalesceSends);
+    }
+    Q_EMIT coalesceSendsChanged(m_coalesceSends);
+}
+
+int QQmlWebSocketThreaded::coalesceDelay() const
+{
+    return m_coalesceDelay;
+}
+
+void QQmlWebSocketThreaded::setCoalesceDelay(int coalesceDelay)
+{
+    coalesceDelay = qMax(0, coalesceDelay);
+    if (m_coalesceDelay == coalesceDelay) {
+        return;
+    }
+    m_coalesceDelay = coalesceDelay;
+    if (m_webSocket) {
+        m_webSocket->setCoalesceDelay(coalesceDelay);
+    }
+    Q_EMIT coalesceDelayChanged(m_coalesceDelay);
+}
+
+double QQmlWebSocketThreaded::roundTripTime() const
+{
+    const qint64 roundTripTime = m_webSocket ? m_webSocket->connectionInfo().roundTripTime : -1;
+    return roundTripTime < 0 ? -1 : roundTripTime / 1e6;
+}
+
+double QQmlWebSocketThreaded::roundTripTimeVariation() const
+{
+    const qint64 variation = m_webSocket ? m_webSocket->connectionInfo().roundTripTimeVariation : -1;
+    return variation < 0 ? -1 : variation / 1e6;
+}
+
+QWebSocketThreadedStats *QQmlWebSocketThreaded::stats() const
+{
+    return m_webSocket ? m_webSocket->stats() : Q_NULLPTR;
+}
+
 void QQmlWebSocketThreaded::open()
 {
     if (m_componentCompleted && m_isActive && m_url.isValid() && Q_LIKELY(m_webSocket)) {
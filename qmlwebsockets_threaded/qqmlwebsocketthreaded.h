@@ -44,8 +44,12 @@
 #include <QObject>
 #include <QQmlParserStatus>
 #include <QtQml>
+#include <QPointer>
+#include <QQuickItem>
+#include <QQuickWindow>
 #include <QScopedPointer>
 #include "qwebsocketthreaded.h"
+#include "qwebsocketthreadedstats.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -59,6 +63,35 @@ class QQmlWebSocketThreaded : public QObject, public QQmlParserStatus
     Q_PROPERTY(Status status READ status NOTIFY statusChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
     Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(qint64 bufferedAmount READ bufferedAmount NOTIFY bufferedAmountChanged REVISION 2)
+    Q_PROPERTY(qint64 highWaterMark READ highWaterMark WRITE setHighWaterMark NOTIFY highWaterMarkChanged REVISION 2)
+    Q_PROPERTY(qint64 sendWindow READ sendWindow WRITE setSendWindow NOTIFY sendWindowChanged REVISION 2)
+    Q_PROPERTY(bool batchMessages READ batchMessages WRITE setBatchMessages NOTIFY batchMessagesChanged REVISION 2)
+    Q_PROPERTY(bool parseJson READ parseJson WRITE setParseJson NOTIFY parseJsonChanged REVISION 2)
+    Q_PROPERTY(bool streamFrames READ streamFrames WRITE setStreamFrames NOTIFY streamFramesChanged REVISION 2)
+    Q_PROPERTY(Transport transport READ transport WRITE setTransport NOTIFY transportChanged REVISION 2)
+    Q_PROPERTY(QWebSocketThreadedStats *stats READ stats NOTIFY statsChanged REVISION 2)
+    Q_PROPERTY(bool compression READ compression WRITE setCompression NOTIFY compressionChanged REVISION 2)
+    Q_PROPERTY(int compressionWindowBits READ compressionWindowBits WRITE setCompressionWindowBits NOTIFY compressionWindowBitsChanged REVISION 2)
+    Q_PROPERTY(bool compressionContextTakeover READ compressionContextTakeover WRITE setCompressionContextTakeover NOTIFY compressionContextTakeoverChanged REVISION 2)
+    Q_PROPERTY(bool autoReconnect READ autoReconnect WRITE setAutoReconnect NOTIFY autoReconnectChanged REVISION 2)
+    Q_PROPERTY(int minBackoff READ minBackoff WRITE setMinBackoff NOTIFY minBackoffChanged REVISION 2)
+    Q_PROPERTY(int maxBackoff READ maxBackoff WRITE setMaxBackoff NOTIFY maxBackoffChanged REVISION 2)
+    Q_PROPERTY(double jitter READ jitter WRITE setJitter NOTIFY jitterChanged REVISION 2)
+    Q_PROPERTY(bool replayMessages READ replayMessages WRITE setReplayMessages NOTIFY replayMessagesChanged REVISION 2)
+    Q_PROPERTY(QVariantList filters READ filters WRITE setFilters NOTIFY filtersChanged REVISION 2)
+    Q_PROPERTY(QString conflationKey READ conflationKey WRITE setConflationKey NOTIFY conflationKeyChanged REVISION 2)
+    Q_PROPERTY(QUrl processorSource READ processorSource WRITE setProcessorSource NOTIFY processorSourceChanged REVISION 2)
+    Q_PROPERTY(int frameBudget READ frameBudget WRITE setFrameBudget NOTIFY frameBudgetChanged REVISION 2)
+    Q_PROPERTY(QQuickWindow *window READ window WRITE setWindow NOTIFY windowChanged REVISION 2)
+    Q_PROPERTY(TextEncoding textEncoding READ textEncoding WRITE setTextEncoding NOTIFY textEncodingChanged REVISION 2)
+    Q_PROPERTY(BinaryFormat binaryFormat READ binaryFormat WRITE setBinaryFormat NOTIFY binaryFormatChanged REVISION 2)
+    Q_PROPERTY(int pingInterval READ pingInterval WRITE setPingInterval NOTIFY pingIntervalChanged REVISION 2)
+    Q_PROPERTY(int pongTimeout READ pongTimeout WRITE setPongTimeout NOTIFY pongTimeoutChanged REVISION 2)
+    Q_PROPERTY(bool coalesceSends READ coalesceSends WRITE setCoalesceSends NOTIFY coalesceSendsChanged REVISION 2)
+    Q_PROPERTY(int coalesceDelay READ coalesceDelay WRITE setCoalesceDelay NOTIFY coalesceDelayChanged REVISION 2)
+    Q_PROPERTY(double roundTripTime READ roundTripTime NOTIFY roundTripTimeChanged REVISION 2)
+    Q_PROPERTY(double roundTripTimeVariation READ roundTripTimeVariation NOTIFY roundTripTimeChanged REVISION 2)
 
 public:
     explicit QQmlWebSocketThreaded(QObject *parent = 0);
@@ -75,6 +108,36 @@ public:
     };
     Q_ENUM(Status)
 
+    enum Transport
+    {
+        SignalTransport = QWebSocketThreaded::SignalTransport,
+        RingTransport   = QWebSocketThreaded::RingTransport
+    };
+    Q_ENUM(Transport)
+
+    enum TextEncoding
+    {
+        Utf16Text = QWebSocketThreaded::Utf16Text,
+        Utf8Text  = QWebSocketThreaded::Utf8Text
+    };
+    Q_ENUM(TextEncoding)
+
+    enum BinaryFormat
+    {
+        RawBinary         = QWebSocketThreaded::RawBinary,
+        CborBinary        = QWebSocketThreaded::CborBinary,
+        MessagePackBinary = QWebSocketThreaded::MessagePackBinary
+    };
+    Q_ENUM(BinaryFormat)
+
+    enum Priority
+    {
+        HighPriority   = QWebSocketThreaded::HighPriority,
+        NormalPriority = QWebSocketThreaded::NormalPriority,
+        LowPriority    = QWebSocketThreaded::LowPriority
+    };
+    Q_ENUM(Priority)
+
     QUrl url() const;
     void setUrl(const QUrl &url);
     Status status() const;
@@ -83,24 +146,135 @@ public:
     void setActive(bool active);
     bool isActive() const;
 
+    qint64 bufferedAmount() const;
+    qint64 highWaterMark() const;
+    void setHighWaterMark(qint64 highWaterMark);
+    qint64 sendWindow() const;
+    void setSendWindow(qint64 sendWindow);
+
+    bool batchMessages() const;
+    void setBatchMessages(bool batchMessages);
+    bool parseJson() const;
+    void setParseJson(bool parseJson);
+    bool streamFrames() const;
+    void setStreamFrames(bool streamFrames);
+    Transport transport() const;
+    void setTransport(Transport transport);
+    bool compression() const;
+    void setCompression(bool compression);
+    int compressionWindowBits() const;
+    void setCompressionWindowBits(int compressionWindowBits);
+    bool compressionContextTakeover() const;
+    void setCompressionContextTakeover(bool contextTakeover);
+    bool autoReconnect() const;
+    void setAutoReconnect(bool autoReconnect);
+    int minBackoff() const;
+    void setMinBackoff(int minBackoff);
+    int maxBackoff() const;
+    void setMaxBackoff(int maxBackoff);
+    double jitter() const;
+    void setJitter(double jitter);
+    bool replayMessages() const;
+    void setReplayMessages(bool replayMessages);
+    QVariantList filters() const;
+    void setFilters(const QVariantList &filters);
+    QString conflationKey() const;
+    void setConflationKey(const QString &conflationKey);
+    QUrl processorSource() const;
+    void setProcessorSource(const QUrl &processorSource);
+    // For C++ companions like WebSocketListModel, takes precedence over
+    // processorSource
+    QSharedPointer<QWebSocketThreadedProcessor> processor() const;
+    void setProcessor(const QSharedPointer<QWebSocketThreadedProcessor> &processor);
+    int frameBudget() const;
+    void setFrameBudget(int frameBudget);
+    QQuickWindow *window() const;
+    void setWindow(QQuickWindow *window);
+    TextEncoding textEncoding() const;
+    void setTextEncoding(TextEncoding textEncoding);
+    BinaryFormat binaryFormat() const;
+    void setBinaryFormat(BinaryFormat binaryFormat);
+    int pingInterval() const;
+    void setPingInterval(int pingInterval);
+    int pongTimeout() const;
+    void setPongTimeout(int pongTimeout);
+    bool coalesceSends() const;
+    void setCoalesceSends(bool coalesceSends);
+    int coalesceDelay() const;
+    void setCoalesceDelay(int coalesceDelay);
+    double roundTripTime() const;
+    double roundTripTimeVariation() const;
+
+    QWebSocketThreadedStats *stats() const;
+
     Q_INVOKABLE qint64 sendTextMessage(const QString &message);
-    Q_REVISION(1) Q_INVOKABLE qint64 sendBinaryMessage(const QByteArray &message);
+    // An ArrayBuffer, or a value encoded with binaryFormat
+    Q_REVISION(1) Q_INVOKABLE qint64 sendBinaryMessage(const QVariant &message);
+    Q_REVISION(2) Q_INVOKABLE qint64 postTextMessage(const QString &message, Priority priority = NormalPriority);
+    Q_REVISION(2) Q_INVOKABLE qint64 postBinaryMessage(const QVariant &message, Priority priority = NormalPriority);
+    Q_REVISION(2) Q_INVOKABLE qint64 sendTextMessageUtf8(const QByteArray &message, Priority priority = NormalPriority);
 
 Q_SIGNALS:
     void textMessageReceived(QString message);
-    Q_REVISION(1) void binaryMessageReceived(QByteArray message);
+    Q_REVISION(1) void binaryMessageReceived(const QByteArray &message);
+    Q_REVISION(2) void jsonMessageReceived(const QVariant &message);
+    Q_REVISION(2) void textFrameReceived(const QString &frame, bool isLastFrame);
+    Q_REVISION(2) void binaryFrameReceived(const QByteArray &frame, bool isLastFrame);
+    Q_REVISION(2) void messagesReceived(const QVariantList &messages);
+    Q_REVISION(2) void processedMessageReceived(const QVariant &message);
+    Q_REVISION(2) void decodedMessageReceived(const QVariant &message);
+    Q_REVISION(2) void routedTextMessageReceived(const QString &route, const QString &message);
+    Q_REVISION(2) void routedBinaryMessageReceived(const QString &route, const QByteArray &message);
+    Q_REVISION(2) void utf8TextMessageReceived(const QByteArray &message);
     void statusChanged(Status status);
     void activeChanged(bool isActive);
     void errorStringChanged(QString errorString);
     void urlChanged();
+    Q_REVISION(2) void bufferedAmountChanged(qint64 bufferedAmount);
+    Q_REVISION(2) void highWaterMarkChanged(qint64 highWaterMark);
+    Q_REVISION(2) void sendWindowChanged(qint64 sendWindow);
+    Q_REVISION(2) void drained();
+    Q_REVISION(2) void messageSent(qint64 messageId, qint64 bytes);
+    Q_REVISION(2) void batchMessagesChanged(bool batchMessages);
+    Q_REVISION(2) void parseJsonChanged(bool parseJson);
+    Q_REVISION(2) void streamFramesChanged(bool streamFrames);
+    Q_REVISION(2) void transportChanged(Transport transport);
+    Q_REVISION(2) void compressionChanged(bool compression);
+    Q_REVISION(2) void compressionWindowBitsChanged(int compressionWindowBits);
+    Q_REVISION(2) void compressionContextTakeoverChanged(bool contextTakeover);
+    Q_REVISION(2) void autoReconnectChanged(bool autoReconnect);
+    Q_REVISION(2) void minBackoffChanged(int minBackoff);
+    Q_REVISION(2) void maxBackoffChanged(int maxBackoff);
+    Q_REVISION(2) void jitterChanged(double jitter);
+    Q_REVISION(2) void replayMessagesChanged(bool replayMessages);
+    Q_REVISION(2) void filtersChanged(const QVariantList &filters);
+    Q_REVISION(2) void conflationKeyChanged(const QString &conflationKey);
+    Q_REVISION(2) void processorSourceChanged(const QUrl &processorSource);
+    Q_REVISION(2) void frameBudgetChanged(int frameBudget);
+    Q_REVISION(2) void windowChanged(QQuickWindow *window);
+    Q_REVISION(2) void textEncodingChanged(TextEncoding textEncoding);
+    Q_REVISION(2) void binaryFormatChanged(BinaryFormat binaryFormat);
+    Q_REVISION(2) void pingIntervalChanged(int pingInterval);
+    Q_REVISION(2) void pongTimeoutChanged(int pongTimeout);
+    Q_REVISION(2) void coalesceSendsChanged(bool coalesceSends);
+    Q_REVISION(2) void coalesceDelayChanged(int coalesceDelay);
+    Q_REVISION(2) void roundTripTimeChanged();
+    Q_REVISION(2) void statsChanged();
 
 public:
     void classBegin() Q_DECL_OVERRIDE;
     void componentComplete() Q_DECL_OVERRIDE;
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) Q_DECL_OVERRIDE;
+
 private Q_SLOTS:
     void onError(QAbstractSocket::SocketError error);
     void onStateChanged(QAbstractSocket::SocketState state);
+    void onMessagesPending();
+    void onConnectionInfoChanged();
+    void onAfterAnimating();
+    void updatePacing();
 
 private:
     QScopedPointer<QWebSocketThreaded> m_webSocket;
@@ -109,9 +283,39 @@ private:
     bool m_isActive;
     bool m_componentCompleted;
     QString m_errorString;
+    qint64 m_highWaterMark;
+    qint64 m_sendWindow;
+    bool m_batchMessages;
+    bool m_parseJson;
+    bool m_streamFrames;
+    Transport m_transport;
+    bool m_compression;
+    int m_compressionWindowBits;
+    bool m_compressionContextTakeover;
+    bool m_autoReconnect;
+    int m_minBackoff;
+    int m_maxBackoff;
+    double m_jitter;
+    bool m_replayMessages;
+    QVariantList m_filters;
+    QString m_conflationKey;
+    QUrl m_processorSource;
+    QSharedPointer<QWebSocketThreadedProcessor> m_processor;
+    int m_frameBudget;
+    // Set from QML, or the window of the closest item ancestor otherwise
+    QPointer<QQuickWindow> m_window;
+    TextEncoding m_textEncoding;
+    QPointer<QQuickItem> m_item;
+    QPointer<QQuickWindow> m_pacingWindow;
+    int m_pingInterval;
+    int m_pongTimeout;
+    bool m_coalesceSends;
+    int m_coalesceDelay;
+    BinaryFormat m_binaryFormat;
 
     // takes ownership of the socket
     void setSocket(QWebSocketThreaded *socket);
+    void updateProcessor();
     void setStatus(Status status);
     void open();
     void close();
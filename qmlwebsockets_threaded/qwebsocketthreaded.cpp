@@ -35,46 +35,230 @@
 ****************************************************************************/
 
 #include "qwebsocketthreaded.h"
+#include "qwebsocketthreaded_p.h"
+#include "qwebsocketthreadedcodec_p.h"
+#include "qwebsocketthreadedstats.h"
+#include "qwebsocketthreadedtrace_p.h"
+#include "qwebsocketthreadpool.h"
 #include <QtWebSockets/QWebSocket>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <limits>
 //#include <QDebug>
 
+// An entry of messagesReceived(), the type tells how data was delivered
+// without batching
+static QVariant batchEntry(const QWebSocketThreadedMessage &message) {
+    QVariantMap entry;
+    switch (message.type) {
+    case QWebSocketThreadedMessage::Binary:
+    case QWebSocketThreadedMessage::BinaryFrame:
+    case QWebSocketThreadedMessage::ChannelBinary:
+        entry.insert(QStringLiteral("type"), QStringLiteral("binary"));
+        entry.insert(QStringLiteral("data"), message.data);
+        break;
+    case QWebSocketThreadedMessage::Utf8Text:
+        entry.insert(QStringLiteral("type"), QStringLiteral("utf8Text"));
+        entry.insert(QStringLiteral("data"), message.data);
+        break;
+    case QWebSocketThreadedMessage::Json:
+        entry.insert(QStringLiteral("type"), QStringLiteral("json"));
+        entry.insert(QStringLiteral("data"), message.value);
+        break;
+    case QWebSocketThreadedMessage::Processed:
+        entry.insert(QStringLiteral("type"), QStringLiteral("processed"));
+        entry.insert(QStringLiteral("data"), message.value);
+        break;
+    case QWebSocketThreadedMessage::Decoded:
+        entry.insert(QStringLiteral("type"), QStringLiteral("decoded"));
+        entry.insert(QStringLiteral("data"), message.value);
+        break;
+    case QWebSocketThreadedMessage::Text:
+    case QWebSocketThreadedMessage::TextFrame:
+    case QWebSocketThreadedMessage::ChannelText:
+        entry.insert(QStringLiteral("type"), QStringLiteral("text"));
+        entry.insert(QStringLiteral("data"), message.text);
+        break;
+    }
+    return entry;
+}
+
 QWebSocketThreaded::QWebSocketThreaded(const QString &origin,
                                        QWebSocketProtocol::Version version,
                                        QObject *parent)
-    : QObject(parent)
+    : QWebSocketThreaded(QWebSocketThreadPool::globalInstance(), origin, version, parent)
 {
-    QWebSocket *websocket = new QWebSocket(origin, version);
-    //QWebSocketWrap *websocket = new QWebSocketWrap(origin, version);
-    websocket->moveToThread(&m_thread);
-    connect(&m_thread, &QThread::finished, websocket, &QObject::deleteLater);
+}
 
-    connect(this, &QWebSocketThreaded::closeCommand, websocket, &QWebSocket::close);
-    connect(this, &QWebSocketThreaded::openCommand, websocket, static_cast<void (QWebSocket::*)(const QUrl &)>(&QWebSocket::open));
-    connect(this, &QWebSocketThreaded::sendTextMessageCommand, websocket, &QWebSocket::sendTextMessage);
-    connect(this, &QWebSocketThreaded::sendBinaryMessageCommand, websocket, &QWebSocket::sendBinaryMessage);
+QWebSocketThreaded::QWebSocketThreaded(QWebSocketThreadPool *pool, const QString &origin,
+                                       QWebSocketProtocol::Version version,
+                                       QObject *parent)
+    : QWebSocketThreaded(pool, Q_NULLPTR, origin, version, parent)
+{
+}
 
-    connect(websocket, &QWebSocket::connected, this, &QWebSocketThreaded::connectedHandler);
-    connect(websocket, &QWebSocket::disconnected, this, &QWebSocketThreaded::disconnectedHandler);
-    connect(websocket, &QWebSocket::stateChanged, this, &QWebSocketThreaded::stateChangedHandler);
-    connect(websocket, &QWebSocket::textMessageReceived, this, &QWebSocketThreaded::textMessageReceivedHandler);
-    connect(websocket, &QWebSocket::binaryMessageReceived, this, &QWebSocketThreaded::binaryMessageReceivedHandler);
-    connect(websocket,
-            static_cast<void (QWebSocket::*)(QAbstractSocket::SocketError)>(&QWebSocket::error),
-            this,
-            &QWebSocketThreaded::errorHandler);
-    
-    m_thread.start();
+QWebSocketThreaded::QWebSocketThreaded(QThread *thread, const QString &origin,
+                                       QWebSocketProtocol::Version version,
+                                       QObject *parent)
+    : QWebSocketThreaded(static_cast<QWebSocketThreadPool *>(Q_NULLPTR), thread, origin, version, parent)
+{
+}
+
+QWebSocketThreaded::QWebSocketThreaded(QWebSocketThreadPool *pool, QThread *thread,
+                                       const QString &origin,
+                                       QWebSocketProtocol::Version version,
+                                       QObject *parent)
+    : QObject(parent),
+      m_pool(pool),
+      m_thread(thread),
+      m_queue(new QWebSocketThreadedQueue),
+      m_counters(new QWebSocketThreadedCounters),
+      m_snapshot(new QWebSocketThreadedSnapshot),
+      m_stats(new QWebSocketThreadedStats(m_counters, this)),
+      m_batchMessages(false),
+      m_parseJson(false),
+      m_streamFrames(false),
+      m_multiplexed(false),
+      m_channels(),
+      m_paced(false),
+      m_filter(),
+      m_keyExtractor(),
+      m_processor(),
+      m_compression(false),
+      m_compressionWindowBits(15),
+      m_compressionContextTakeover(true),
+      m_autoReconnect(false),
+      m_minBackoff(1000),
+      m_maxBackoff(30000),
+      m_jitter(0.5),
+      m_replayMessages(false),
+      m_pingInterval(0),
+      m_pongTimeout(10000),
+      m_coalesceSends(false),
+      m_coalesceDelay(0),
+      m_transport(SignalTransport),
+      m_textEncoding(Utf16Text),
+      m_binaryFormat(RawBinary),
+      m_rings(),
+      m_bufferPool(new QWebSocketThreadedBufferPool),
+      m_bufferedAmount(0),
+      m_highWaterMark(0),
+      m_sendWindow(0),
+      m_lastMessageId(0),
+      m_pending(),
+      m_pendingIndex(0)
+{
+    QWebSocketThreadedWorker *worker = new QWebSocketThreadedWorker(origin, version, m_queue, m_counters,
+                                                                    m_snapshot);
+    m_worker = worker;
+
+    connect(this, &QWebSocketThreaded::closeCommand, worker, &QWebSocketThreadedWorker::close);
+    connect(this, &QWebSocketThreaded::openCommand, worker, &QWebSocketThreadedWorker::open);
+    connect(this, &QWebSocketThreaded::shutdownCommand, worker, &QWebSocketThreadedWorker::shutdown);
+    connect(this, &QWebSocketThreaded::sendTextMessageCommand, worker, &QWebSocketThreadedWorker::sendTextMessage);
+    connect(this, &QWebSocketThreaded::sendUtf8TextMessageCommand, worker, &QWebSocketThreadedWorker::sendUtf8TextMessage);
+    connect(this, &QWebSocketThreaded::sendBinaryMessageCommand, worker, &QWebSocketThreadedWorker::sendBinaryMessage);
+    connect(this, &QWebSocketThreaded::sendBinaryBufferCommand, worker, &QWebSocketThreadedWorker::sendBinaryBuffer);
+    connect(this, &QWebSocketThreaded::sendEncodedMessageCommand, worker, &QWebSocketThreadedWorker::sendEncodedMessage);
+    connect(this, &QWebSocketThreaded::setBatchMessagesCommand, worker, &QWebSocketThreadedWorker::setBatchMessages);
+    connect(this, &QWebSocketThreaded::setParseJsonCommand, worker, &QWebSocketThreadedWorker::setParseJson);
+    connect(this, &QWebSocketThreaded::setStreamFramesCommand, worker, &QWebSocketThreadedWorker::setStreamFrames);
+    connect(this, &QWebSocketThreaded::setMultiplexedCommand, worker, &QWebSocketThreadedWorker::setMultiplexed);
+    connect(this, &QWebSocketThreaded::setChannelsCommand, worker, &QWebSocketThreadedWorker::setChannels);
+    connect(this, &QWebSocketThreaded::setFilterCommand, worker, &QWebSocketThreadedWorker::setFilter);
+    connect(this, &QWebSocketThreaded::setKeyExtractorCommand, worker, &QWebSocketThreadedWorker::setKeyExtractor);
+    connect(this, &QWebSocketThreaded::setProcessorCommand, worker, &QWebSocketThreadedWorker::setProcessor);
+    connect(this, &QWebSocketThreaded::setPacedCommand, worker, &QWebSocketThreadedWorker::setPaced);
+    connect(this, &QWebSocketThreaded::setUtf8TextCommand, worker, &QWebSocketThreadedWorker::setUtf8Text);
+    connect(this, &QWebSocketThreaded::setBinaryFormatCommand, worker, &QWebSocketThreadedWorker::setBinaryFormat);
+    connect(this, &QWebSocketThreaded::setSendWindowCommand, worker, &QWebSocketThreadedWorker::setSendWindow);
+    connect(this, &QWebSocketThreaded::sendChannelTextMessageCommand, worker, &QWebSocketThreadedWorker::sendChannelTextMessage);
+    connect(this, &QWebSocketThreaded::sendChannelBinaryMessageCommand, worker, &QWebSocketThreadedWorker::sendChannelBinaryMessage);
+    connect(this, &QWebSocketThreaded::setCompressionCommand, worker, &QWebSocketThreadedWorker::setCompression);
+    connect(this, &QWebSocketThreaded::setReconnectPolicyCommand, worker, &QWebSocketThreadedWorker::setReconnectPolicy);
+    connect(this, &QWebSocketThreaded::setKeepaliveCommand, worker, &QWebSocketThreadedWorker::setKeepalive);
+    connect(this, &QWebSocketThreaded::setCoalescingCommand, worker, &QWebSocketThreadedWorker::setCoalescing);
+    connect(this, &QWebSocketThreaded::pingCommand, worker, &QWebSocketThreadedWorker::ping);
+    connect(this, &QWebSocketThreaded::setRingTransportCommand, worker, &QWebSocketThreadedWorker::setRingTransport);
+    connect(this, &QWebSocketThreaded::commandsPushedCommand, worker, &QWebSocketThreadedWorker::processCommands);
+
+    connect(worker, &QWebSocketThreadedWorker::connected, this, &QWebSocketThreaded::connectedHandler);
+    connect(worker, &QWebSocketThreadedWorker::disconnected, this, &QWebSocketThreaded::disconnectedHandler);
+    connect(worker, &QWebSocketThreadedWorker::stateChanged, this, &QWebSocketThreaded::stateChangedHandler);
+    connect(worker, &QWebSocketThreadedWorker::textFrameReceived, this, &QWebSocketThreaded::textFrameReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::binaryFrameReceived, this, &QWebSocketThreaded::binaryFrameReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::textMessageReceived, this, &QWebSocketThreaded::textMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::utf8TextMessageReceived, this, &QWebSocketThreaded::utf8TextMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::binaryMessageReceived, this, &QWebSocketThreaded::binaryMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::jsonMessageReceived, this, &QWebSocketThreaded::jsonMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::processedMessageReceived, this, &QWebSocketThreaded::processedMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::decodedMessageReceived, this, &QWebSocketThreaded::decodedMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::channelTextMessageReceived, this, &QWebSocketThreaded::channelTextMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::channelBinaryMessageReceived, this, &QWebSocketThreaded::channelBinaryMessageReceivedHandler);
+    connect(worker, &QWebSocketThreadedWorker::error, this, &QWebSocketThreaded::errorHandler);
+    connect(worker, &QWebSocketThreadedWorker::messagesQueued, this, &QWebSocketThreaded::messagesQueuedHandler);
+    connect(worker, &QWebSocketThreadedWorker::messagesPushed, this, &QWebSocketThreaded::messagesPushedHandler);
+    connect(worker, &QWebSocketThreadedWorker::bytesWritten, this, &QWebSocketThreaded::bytesWrittenHandler);
+    connect(worker, &QWebSocketThreadedWorker::messageSent, this, &QWebSocketThreaded::messageSentHandler);
+    connect(worker, &QWebSocketThreadedWorker::bufferedAmountAdjusted, this, &QWebSocketThreaded::bufferedAmountAdjustedHandler);
+    connect(worker, &QWebSocketThreadedWorker::connectionInfoChanged, this, &QWebSocketThreaded::connectionInfoChangedHandler);
+    connect(worker, &QWebSocketThreadedWorker::pong, this, &QWebSocketThreaded::pongHandler);
 }
 QWebSocketThreaded::~QWebSocketThreaded() {
-    m_thread.quit();
-    m_thread.wait();
+    // The worker finishes the close handshake and destroys itself on the
+    // network thread, which only goes back to the pool then. Nothing waits
+    // for it here, unless the pool is destroyed first: then the handshake
+    // is cut short before the thread stops.
+    if (m_pool && m_thread) {
+        QWebSocketThreadPool *pool = m_pool;
+        QThread *thread = m_thread;
+        connect(m_worker, &QObject::destroyed, pool, [pool, thread]() {
+            pool->release(thread);
+        });
+        connect(pool, &QWebSocketThreadPool::threadsStopping, m_worker,
+                &QWebSocketThreadedWorker::abortShutdown, Qt::BlockingQueuedConnection);
+    }
+    shutdownCommand();
+}
+
+void QWebSocketThreaded::moveWorkerToThread() {
+    if (!m_thread) {
+        m_thread = m_pool->acquire();
+    }
+    if (m_worker->thread() != m_thread) {
+        m_worker->moveToThread(m_thread);
+    }
 }
 
 void QWebSocketThreaded::close(QWebSocketProtocol::CloseCode closeCode, const QString &reason) {
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::Close;
+        command.closeCode = closeCode;
+        command.text = reason;
+        command.messageId = 0;
+        command.priority = NormalPriority;
+        pushCommand(command);
+        return;
+    }
     closeCommand(closeCode, reason);
 }
+void QWebSocketThreaded::ping(const QByteArray &payload) {
+    pingCommand(payload);
+}
 void QWebSocketThreaded::open(const QUrl &url) {
     m_url = url;
+    moveWorkerToThread();
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::Open;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.url = url;
+        command.messageId = 0;
+        command.priority = NormalPriority;
+        pushCommand(command);
+        return;
+    }
     openCommand(url);
 }
 
@@ -84,43 +268,703 @@ void QWebSocketThreaded::connectedHandler() {
 }
 void QWebSocketThreaded::disconnectedHandler() {
     //qDebug() << "disconnectedHandler";
+    // The worker takes what the connection dropped off bufferedAmount with
+    // bufferedAmountAdjusted(), messages kept for replay stay accounted
     disconnected();
 }
 void QWebSocketThreaded::stateChangedHandler(QAbstractSocket::SocketState state) {
     //qDebug() << "stateChangedHandler";
-    m_state = state;
     stateChanged(state);
 }
-void QWebSocketThreaded::textMessageReceivedHandler(const QString &message) {
+void QWebSocketThreaded::textFrameReceivedHandler(const QString &frame, bool isLastFrame, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    textFrameReceived(frame, isLastFrame);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::binaryFrameReceivedHandler(const QByteArray &frame, bool isLastFrame, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    binaryFrameReceived(frame, isLastFrame);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::textMessageReceivedHandler(const QString &message, qint64 receivedAt) {
     //qDebug() << "textMessageReceivedHandler";
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
     textMessageReceived(message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
 }
-void QWebSocketThreaded::binaryMessageReceivedHandler(const QByteArray &message) {
+void QWebSocketThreaded::utf8TextMessageReceivedHandler(const QByteArray &message, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    utf8TextMessageReceived(message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::binaryMessageReceivedHandler(const QByteArray &message, qint64 receivedAt) {
     //qDebug() << "binaryMessageReceivedHandler";
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
     binaryMessageReceived(message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::jsonMessageReceivedHandler(const QVariant &message, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    jsonMessageReceived(message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::processedMessageReceivedHandler(const QVariant &message, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    processedMessageReceived(message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::decodedMessageReceivedHandler(const QVariant &message, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    decodedMessageReceived(message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::channelTextMessageReceivedHandler(const QString &channel, const QString &message, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    channelTextMessageReceived(channel, message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
+}
+void QWebSocketThreaded::channelBinaryMessageReceivedHandler(const QString &channel, const QByteArray &message, qint64 receivedAt) {
+    m_counters->dispatched(receivedAt);
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), receivedAt);
+    channelBinaryMessageReceived(channel, message);
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), receivedAt);
 }
 void QWebSocketThreaded::errorHandler(QAbstractSocket::SocketError err) {
     //qDebug() << "errorHandler";
     error(err);
 }
+void QWebSocketThreaded::messagesQueuedHandler() {
+    if (m_paced) {
+        messagesPending();
+        return;
+    }
+    dispatchPending(std::numeric_limits<qint64>::max());
+}
+bool QWebSocketThreaded::dispatchPending(qint64 budget) {
+    if (m_pendingIndex >= m_pending.size()) {
+        m_pending = m_queue->takeAll();
+        m_pendingIndex = 0;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QVariantList messages;
+    while (m_pendingIndex < m_pending.size()) {
+        const QWebSocketThreadedMessage &message = m_pending.at(m_pendingIndex++);
+        m_counters->dispatched(message.receivedAt);
+        // Frames and channel messages are only queued when paced
+        if (m_batchMessages && !message.isFrame() && !message.isChannel()) {
+            messages.append(batchEntry(message));
+        } else {
+            dispatch(message);
+        }
+        if (timer.nsecsElapsed() >= budget) {
+            break;
+        }
+    }
+    if (!messages.isEmpty()) {
+        Q_TRACE(QWebSocketThreaded_batch_entry, m_counters.data(), messages.size());
+        messagesReceived(messages);
+        Q_TRACE(QWebSocketThreaded_batch_exit, m_counters.data(), messages.size());
+    }
+    if (m_pendingIndex < m_pending.size()) {
+        return true;
+    }
+    m_pending.clear();
+    m_pendingIndex = 0;
+    return false;
+}
+void QWebSocketThreaded::messagesPushedHandler() {
+    if (!m_rings) {
+        return;
+    }
+    QVariantList messages;
+    QWebSocketThreadedMessage message;
+    do {
+        while (m_rings->messages.pop(&message)) {
+            m_counters->dispatched(message.receivedAt);
+            if (m_batchMessages && !message.isFrame() && !message.isChannel()) {
+                messages.append(batchEntry(message));
+            } else {
+                dispatch(message);
+            }
+        }
+    } while (!m_rings->messages.sleep());
+    if (!messages.isEmpty()) {
+        Q_TRACE(QWebSocketThreaded_batch_entry, m_counters.data(), messages.size());
+        messagesReceived(messages);
+        Q_TRACE(QWebSocketThreaded_batch_exit, m_counters.data(), messages.size());
+    }
+}
+void QWebSocketThreaded::bytesWrittenHandler(qint64 bytes) {
+    // Pongs and close frames QWebSocket writes on its own are not accounted
+    // for, so this could go slightly below zero
+    setBufferedAmount(m_bufferedAmount - bytes);
+    bytesWritten(bytes);
+}
+void QWebSocketThreaded::messageSentHandler(qint64 messageId, qint64 bytes) {
+    messageSent(messageId, bytes);
+}
+void QWebSocketThreaded::bufferedAmountAdjustedHandler(qint64 delta) {
+    setBufferedAmount(m_bufferedAmount + delta);
+}
+void QWebSocketThreaded::pongHandler(quint64 elapsedTime, const QByteArray &payload) {
+    pong(elapsedTime, payload);
+}
+void QWebSocketThreaded::connectionInfoChangedHandler() {
+    // Before anything reads it, so that a change published meanwhile
+    // notifies again
+    m_snapshot->notified();
+    connectionInfoChanged();
+}
 
+QAbstractSocket::SocketError QWebSocketThreaded::error() const {
+    return m_snapshot->error();
+}
 QString QWebSocketThreaded::errorString() const {
-    // TODO
-    return m_errorString;
+    return m_snapshot->info().errorString;
 }
 QAbstractSocket::SocketState QWebSocketThreaded::state() const {
-    return m_state;
+    return m_snapshot->state();
+}
+QHostAddress QWebSocketThreaded::peerAddress() const {
+    return m_snapshot->info().peerAddress;
+}
+quint16 QWebSocketThreaded::peerPort() const {
+    return m_snapshot->info().peerPort;
+}
+QWebSocketProtocol::CloseCode QWebSocketThreaded::closeCode() const {
+    return m_snapshot->info().closeCode;
+}
+QString QWebSocketThreaded::closeReason() const {
+    return m_snapshot->info().closeReason;
+}
+QWebSocketThreadedConnectionInfo QWebSocketThreaded::connectionInfo() const {
+    return m_snapshot->info();
 }
 QUrl QWebSocketThreaded::requestUrl() const {
     return m_url;
 }
-qint64 QWebSocketThreaded::sendTextMessage(const QString &message) {
-    sendTextMessageCommand(message);
-    // TODO: get length? That needs sync blocking
+qint64 QWebSocketThreaded::sendTextMessage(const QString &message, Priority priority) {
+    queueTextMessage(message, -(++m_lastMessageId), priority);
+    // The length is only known on the network thread, see postTextMessage()
+    return -1;
+}
+qint64 QWebSocketThreaded::sendBinaryMessage(const QByteArray &data, Priority priority) {
+    queueBinaryMessage(data, -(++m_lastMessageId), priority);
+    // The length is only known on the network thread, see postBinaryMessage()
+    return -1;
+}
+qint64 QWebSocketThreaded::sendTextMessageUtf8(const QByteArray &message, Priority priority) {
+    const qint64 messageId = -(++m_lastMessageId);
+    Q_TRACE(QWebSocketThreaded_send_issued, m_counters.data(), messageId, message.size());
+    setBufferedAmount(m_bufferedAmount + message.size());
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendUtf8Text;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.data = message;
+        command.messageId = messageId;
+        command.priority = priority;
+        pushCommand(command);
+        return -1;
+    }
+    sendUtf8TextMessageCommand(message, messageId, priority);
     return -1;
 }
-qint64 QWebSocketThreaded::sendBinaryMessage(const QByteArray &data) {
-    sendBinaryMessageCommand(data);
-    // TODO: get length? That needs sync blocking
+qint64 QWebSocketThreaded::sendEncodedMessage(const QVariant &message, Priority priority) {
+    if (m_binaryFormat == RawBinary) {
+        qWarning("QWebSocketThreaded: encoded messages need a binary format");
+        return 0;
+    }
+    queueEncodedMessage(message, -(++m_lastMessageId), priority);
     return -1;
 }
+qint64 QWebSocketThreaded::postTextMessage(const QString &message, Priority priority) {
+    const qint64 messageId = ++m_lastMessageId;
+    queueTextMessage(message, messageId, priority);
+    return messageId;
+}
+qint64 QWebSocketThreaded::postBinaryMessage(const QByteArray &data, Priority priority) {
+    const qint64 messageId = ++m_lastMessageId;
+    queueBinaryMessage(data, messageId, priority);
+    return messageId;
+}
+qint64 QWebSocketThreaded::postEncodedMessage(const QVariant &message, Priority priority) {
+    if (m_binaryFormat == RawBinary) {
+        qWarning("QWebSocketThreaded: encoded messages need a binary format");
+        return 0;
+    }
+    const qint64 messageId = ++m_lastMessageId;
+    queueEncodedMessage(message, messageId, priority);
+    return messageId;
+}
+QWebSocketThreadedBufferPool *QWebSocketThreaded::bufferPool() const {
+    return m_bufferPool.data();
+}
+qint64 QWebSocketThreaded::postBinaryBuffer(const QWebSocketThreadedBuffer &buffer, Priority priority) {
+    const qint64 messageId = ++m_lastMessageId;
+    Q_TRACE(QWebSocketThreaded_send_issued, m_counters.data(), messageId, buffer.size());
+    setBufferedAmount(m_bufferedAmount + buffer.size());
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendBuffer;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.buffer = buffer;
+        command.messageId = messageId;
+        command.priority = priority;
+        pushCommand(command);
+        return messageId;
+    }
+    sendBinaryBufferCommand(buffer, messageId, priority);
+    return messageId;
+}
+void QWebSocketThreaded::sendChannelTextMessage(const QString &channel, const QString &message) {
+    // The first ':' ends the channel on the receiving side
+    if (channel.contains(QLatin1Char(':'))) {
+        qWarning("QWebSocketThreaded: channel ids of text messages can't contain ':'");
+        return;
+    }
+    setBufferedAmount(m_bufferedAmount + qWebSocketThreadedUtf8Size(channel) + 1
+                      + qWebSocketThreadedUtf8Size(message));
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendChannelText;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.channel = channel;
+        command.text = message;
+        command.messageId = 0;
+        command.priority = NormalPriority;
+        pushCommand(command);
+        return;
+    }
+    sendChannelTextMessageCommand(channel, message);
+}
+void QWebSocketThreaded::sendChannelBinaryMessage(const QString &channel, const QByteArray &data) {
+    const int channelSize = int(qWebSocketThreadedUtf8Size(channel));
+    if (channelSize > 255) {
+        qWarning("QWebSocketThreaded: channel id of %d bytes is too long for binary messages", channelSize);
+        return;
+    }
+    setBufferedAmount(m_bufferedAmount + 1 + channelSize + data.size());
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendChannelBinary;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.channel = channel;
+        command.data = data;
+        command.messageId = 0;
+        command.priority = NormalPriority;
+        pushCommand(command);
+        return;
+    }
+    sendChannelBinaryMessageCommand(channel, data);
+}
+void QWebSocketThreaded::queueTextMessage(const QString &message, qint64 messageId, Priority priority) {
+    // Corrected to the wire size by the network thread, see bufferedAmount()
+    const qint64 size = qWebSocketThreadedUtf8Size(message);
+    Q_TRACE(QWebSocketThreaded_send_issued, m_counters.data(), messageId, size);
+    setBufferedAmount(m_bufferedAmount + size);
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendText;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.text = message;
+        command.messageId = messageId;
+        command.priority = priority;
+        pushCommand(command);
+        return;
+    }
+    sendTextMessageCommand(message, messageId, priority);
+}
+void QWebSocketThreaded::queueBinaryMessage(const QByteArray &data, qint64 messageId, Priority priority) {
+    Q_TRACE(QWebSocketThreaded_send_issued, m_counters.data(), messageId, data.size());
+    setBufferedAmount(m_bufferedAmount + data.size());
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendBinary;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.data = data;
+        command.messageId = messageId;
+        command.priority = priority;
+        pushCommand(command);
+        return;
+    }
+    sendBinaryMessageCommand(data, messageId, priority);
+}
+void QWebSocketThreaded::queueEncodedMessage(const QVariant &message, qint64 messageId, Priority priority) {
+    // The size is only known once encoded
+    Q_TRACE(QWebSocketThreaded_send_issued, m_counters.data(), messageId, -1);
+    // Accounted for by bufferedAmountAdjusted() once encoded
+    if (m_transport == RingTransport) {
+        QWebSocketThreadedCommand command;
+        command.type = QWebSocketThreadedCommand::SendEncoded;
+        command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+        command.value = message;
+        command.messageId = messageId;
+        command.priority = priority;
+        pushCommand(command);
+        return;
+    }
+    sendEncodedMessageCommand(message, messageId, priority);
+}
+qint64 QWebSocketThreaded::bufferedAmount() const {
+    return m_bufferedAmount;
+}
+qint64 QWebSocketThreaded::highWaterMark() const {
+    return m_highWaterMark;
+}
+void QWebSocketThreaded::setHighWaterMark(qint64 highWaterMark) {
+    m_highWaterMark = qMax<qint64>(0, highWaterMark);
+}
+qint64 QWebSocketThreaded::sendWindow() const {
+    return m_sendWindow;
+}
+void QWebSocketThreaded::setSendWindow(qint64 sendWindow) {
+    sendWindow = qMax<qint64>(0, sendWindow);
+    if (m_sendWindow == sendWindow) {
+        return;
+    }
+    m_sendWindow = sendWindow;
+    setSendWindowCommand(sendWindow);
+}
+void QWebSocketThreaded::setBufferedAmount(qint64 bufferedAmount) {
+    bufferedAmount = qMax<qint64>(0, bufferedAmount);
+    if (m_bufferedAmount == bufferedAmount) {
+        return;
+    }
+    const bool wasAboveHighWaterMark = m_bufferedAmount > m_highWaterMark;
+    m_bufferedAmount = bufferedAmount;
+    bufferedAmountChanged(bufferedAmount);
+    if (wasAboveHighWaterMark && bufferedAmount <= m_highWaterMark) {
+        drained();
+    }
+}
+bool QWebSocketThreaded::batchMessages() const {
+    return m_batchMessages;
+}
+void QWebSocketThreaded::setBatchMessages(bool batchMessages) {
+    if (m_batchMessages == batchMessages) {
+        return;
+    }
+    m_batchMessages = batchMessages;
+    setBatchMessagesCommand(batchMessages);
+    if (!batchMessages) {
+        // Don't leave already collected messages behind the ones that will now
+        // come one by one
+        messagesQueuedHandler();
+    }
+}
+bool QWebSocketThreaded::parseJson() const {
+    return m_parseJson;
+}
+void QWebSocketThreaded::setParseJson(bool parseJson) {
+    if (m_parseJson == parseJson) {
+        return;
+    }
+    m_parseJson = parseJson;
+    setParseJsonCommand(parseJson);
+}
+bool QWebSocketThreaded::streamFrames() const {
+    return m_streamFrames;
+}
+void QWebSocketThreaded::setStreamFrames(bool streamFrames) {
+    if (m_streamFrames == streamFrames) {
+        return;
+    }
+    m_streamFrames = streamFrames;
+    setStreamFramesCommand(streamFrames);
+}
+bool QWebSocketThreaded::autoReconnect() const {
+    return m_autoReconnect;
+}
+void QWebSocketThreaded::setAutoReconnect(bool autoReconnect) {
+    if (m_autoReconnect == autoReconnect) {
+        return;
+    }
+    m_autoReconnect = autoReconnect;
+    updateReconnectPolicy();
+}
+int QWebSocketThreaded::minBackoff() const {
+    return m_minBackoff;
+}
+void QWebSocketThreaded::setMinBackoff(int minBackoff) {
+    minBackoff = qMax(0, minBackoff);
+    if (m_minBackoff == minBackoff) {
+        return;
+    }
+    m_minBackoff = minBackoff;
+    updateReconnectPolicy();
+}
+int QWebSocketThreaded::maxBackoff() const {
+    return m_maxBackoff;
+}
+void QWebSocketThreaded::setMaxBackoff(int maxBackoff) {
+    maxBackoff = qMax(0, maxBackoff);
+    if (m_maxBackoff == maxBackoff) {
+        return;
+    }
+    m_maxBackoff = maxBackoff;
+    updateReconnectPolicy();
+}
+double QWebSocketThreaded::jitter() const {
+    return m_jitter;
+}
+void QWebSocketThreaded::setJitter(double jitter) {
+    jitter = qBound(0.0, jitter, 1.0);
+    if (qFuzzyCompare(m_jitter, jitter)) {
+        return;
+    }
+    m_jitter = jitter;
+    updateReconnectPolicy();
+}
+bool QWebSocketThreaded::replayMessages() const {
+    return m_replayMessages;
+}
+void QWebSocketThreaded::setReplayMessages(bool replayMessages) {
+    if (m_replayMessages == replayMessages) {
+        return;
+    }
+    m_replayMessages = replayMessages;
+    updateReconnectPolicy();
+}
+int QWebSocketThreaded::pingInterval() const {
+    return m_pingInterval;
+}
+void QWebSocketThreaded::setPingInterval(int pingInterval) {
+    pingInterval = qMax(0, pingInterval);
+    if (m_pingInterval == pingInterval) {
+        return;
+    }
+    m_pingInterval = pingInterval;
+    setKeepaliveCommand(m_pingInterval, m_pongTimeout);
+}
+int QWebSocketThreaded::pongTimeout() const {
+    return m_pongTimeout;
+}
+void QWebSocketThreaded::setPongTimeout(int pongTimeout) {
+    pongTimeout = qMax(0, pongTimeout);
+    if (m_pongTimeout == pongTimeout) {
+        return;
+    }
+    m_pongTimeout = pongTimeout;
+    setKeepaliveCommand(m_pingInterval, m_pongTimeout);
+}
+bool QWebSocketThreaded::coalesceSends() const {
+    return m_coalesceSends;
+}
+void QWebSocketThreaded::setCoalesceSends(bool coalesceSends) {
+    if (m_coalesceSends == coalesceSends) {
+        return;
+    }
+    m_coalesceSends = coalesceSends;
+    setCoalescingCommand(m_coalesceSends, m_coalesceDelay);
+}
+int QWebSocketThreaded::coalesceDelay() const {
+    return m_coalesceDelay;
+}
+void QWebSocketThreaded::setCoalesceDelay(int coalesceDelay) {
+    coalesceDelay = qMax(0, coalesceDelay);
+    if (m_coalesceDelay == coalesceDelay) {
+        return;
+    }
+    m_coalesceDelay = coalesceDelay;
+    setCoalescingCommand(m_coalesceSends, m_coalesceDelay);
+}
+void QWebSocketThreaded::updateReconnectPolicy() {
+    setReconnectPolicyCommand(m_autoReconnect, m_minBackoff, m_maxBackoff, m_jitter, m_replayMessages);
+}
+bool QWebSocketThreaded::multiplexed() const {
+    return m_multiplexed;
+}
+void QWebSocketThreaded::setMultiplexed(bool multiplexed) {
+    if (m_multiplexed == multiplexed) {
+        return;
+    }
+    m_multiplexed = multiplexed;
+    setMultiplexedCommand(multiplexed);
+}
+QStringList QWebSocketThreaded::channels() const {
+    return m_channels;
+}
+void QWebSocketThreaded::setChannels(const QStringList &channels) {
+    if (m_channels == channels) {
+        return;
+    }
+    m_channels = channels;
+    setChannelsCommand(channels);
+}
+QSharedPointer<QWebSocketThreadedFilter> QWebSocketThreaded::filter() const {
+    return m_filter;
+}
+void QWebSocketThreaded::setFilter(const QSharedPointer<QWebSocketThreadedFilter> &filter) {
+    if (m_filter == filter) {
+        return;
+    }
+    m_filter = filter;
+    setFilterCommand(filter);
+}
+QSharedPointer<QWebSocketThreadedKeyExtractor> QWebSocketThreaded::keyExtractor() const {
+    return m_keyExtractor;
+}
+void QWebSocketThreaded::setKeyExtractor(const QSharedPointer<QWebSocketThreadedKeyExtractor> &keyExtractor) {
+    if (m_keyExtractor == keyExtractor) {
+        return;
+    }
+    m_keyExtractor = keyExtractor;
+    setKeyExtractorCommand(keyExtractor);
+}
+QSharedPointer<QWebSocketThreadedProcessor> QWebSocketThreaded::processor() const {
+    return m_processor;
+}
+void QWebSocketThreaded::setProcessor(const QSharedPointer<QWebSocketThreadedProcessor> &processor) {
+    if (m_processor == processor) {
+        return;
+    }
+    m_processor = processor;
+    setProcessorCommand(processor);
+}
+bool QWebSocketThreaded::paced() const {
+    return m_paced;
+}
+void QWebSocketThreaded::setPaced(bool paced) {
+    if (m_paced == paced) {
+        return;
+    }
+    m_paced = paced;
+    setPacedCommand(paced);
+    if (!m_paced) {
+        // The rest of the messages taken for the last frame, then the ones
+        // that were queued since, no new messagesQueued() comes for those
+        dispatchPending(std::numeric_limits<qint64>::max());
+        dispatchPending(std::numeric_limits<qint64>::max());
+    }
+}
+bool QWebSocketThreaded::compression() const {
+    return m_compression;
+}
+void QWebSocketThreaded::setCompression(bool compression) {
+    if (m_compression == compression) {
+        return;
+    }
+    m_compression = compression;
+    setCompressionCommand(m_compression, m_compressionWindowBits, m_compressionContextTakeover);
+}
+int QWebSocketThreaded::compressionWindowBits() const {
+    return m_compressionWindowBits;
+}
+void QWebSocketThreaded::setCompressionWindowBits(int windowBits) {
+    windowBits = qBound(9, windowBits, 15);
+    if (m_compressionWindowBits == windowBits) {
+        return;
+    }
+    m_compressionWindowBits = windowBits;
+    setCompressionCommand(m_compression, m_compressionWindowBits, m_compressionContextTakeover);
+}
+bool QWebSocketThreaded::compressionContextTakeover() const {
+    return m_compressionContextTakeover;
+}
+void QWebSocketThreaded::setCompressionContextTakeover(bool contextTakeover) {
+    if (m_compressionContextTakeover == contextTakeover) {
+        return;
+    }
+    m_compressionContextTakeover = contextTakeover;
+    setCompressionCommand(m_compression, m_compressionWindowBits, m_compressionContextTakeover);
+}
+QWebSocketThreadedStats *QWebSocketThreaded::stats() const {
+    return m_stats;
+}
+QWebSocketThreaded::Transport QWebSocketThreaded::transport() const {
+    return m_transport;
+}
+void QWebSocketThreaded::setTransport(Transport transport) {
+    if (m_transport == transport) {
+        return;
+    }
+    m_transport = transport;
+    if (transport == RingTransport) {
+        // Allocated on first use only, the rings are a few kilobytes each.
+        // The worker keeps its reference even after switching back, so
+        // commands still in the ring are not lost.
+        if (!m_rings) {
+            m_rings.reset(new QWebSocketThreadedRings);
+        }
+        setRingTransportCommand(m_rings);
+    } else {
+        setRingTransportCommand(QSharedPointer<QWebSocketThreadedRings>());
+        messagesPushedHandler();
+    }
+}
+QWebSocketThreaded::TextEncoding QWebSocketThreaded::textEncoding() const {
+    return m_textEncoding;
+}
+void QWebSocketThreaded::setTextEncoding(TextEncoding textEncoding) {
+    if (m_textEncoding == textEncoding) {
+        return;
+    }
+    m_textEncoding = textEncoding;
+    setUtf8TextCommand(textEncoding == Utf8Text);
+}
+QWebSocketThreaded::BinaryFormat QWebSocketThreaded::binaryFormat() const {
+    return m_binaryFormat;
+}
+void QWebSocketThreaded::setBinaryFormat(BinaryFormat binaryFormat) {
+    if (m_binaryFormat == binaryFormat) {
+        return;
+    }
+    if (!QWebSocketThreadedCodec::isSupported(binaryFormat)) {
+        qWarning("QWebSocketThreaded: binary format %d isn't supported by this Qt build", int(binaryFormat));
+        return;
+    }
+    m_binaryFormat = binaryFormat;
+    setBinaryFormatCommand(binaryFormat);
+}
+void QWebSocketThreaded::pushCommand(const QWebSocketThreadedCommand &command) {
+    if (m_rings->commands.push(command)) {
+        commandsPushedCommand();
+    }
+}
+void QWebSocketThreaded::dispatch(const QWebSocketThreadedMessage &message) {
+    Q_TRACE(QWebSocketThreaded_dispatch_entry, m_counters.data(), message.receivedAt);
+    switch (message.type) {
+    case QWebSocketThreadedMessage::Text:
+        textMessageReceived(message.text);
+        break;
+    case QWebSocketThreadedMessage::Binary:
+        binaryMessageReceived(message.data);
+        break;
+    case QWebSocketThreadedMessage::Json:
+        jsonMessageReceived(message.value);
+        break;
+    case QWebSocketThreadedMessage::TextFrame:
+        textFrameReceived(message.text, message.isLastFrame);
+        break;
+    case QWebSocketThreadedMessage::BinaryFrame:
+        binaryFrameReceived(message.data, message.isLastFrame);
+        break;
+    case QWebSocketThreadedMessage::ChannelText:
+        channelTextMessageReceived(message.channel, message.text);
+        break;
+    case QWebSocketThreadedMessage::ChannelBinary:
+        channelBinaryMessageReceived(message.channel, message.data);
+        break;
+    case QWebSocketThreadedMessage::Utf8Text:
+        utf8TextMessageReceived(message.data);
+        break;
+    case QWebSocketThreadedMessage::Processed:
+        processedMessageReceived(message.value);
+        break;
+    case QWebSocketThreadedMessage::Decoded:
+        decodedMessageReceived(message.value);
+        break;
+    }
+    Q_TRACE(QWebSocketThreaded_dispatch_exit, m_counters.data(), message.receivedAt);
+}
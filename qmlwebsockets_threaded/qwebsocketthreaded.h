@@ -42,34 +42,134 @@
 #ifndef QWEBSOCKETTHREADED_H
 #define QWEBSOCKETTHREADED_H
 
+#include <QHostAddress>
 #include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
 #include <QThread>
+#include <QVariantList>
 #include <QtWebSockets/QWebSocket>
+#include "qwebsocketthreadedbufferpool.h"
+#include "qwebsocketthreadedfilter.h"
+#include "qwebsocketthreadedprocessor.h"
 
 QT_BEGIN_NAMESPACE
 
+class QWebSocketThreadedQueue;
+class QWebSocketThreadedSnapshot;
+class QWebSocketThreadedStats;
+class QWebSocketThreadPool;
+class QWebSocketThreadedWorker;
+struct QWebSocketThreadedCommand;
+struct QWebSocketThreadedCounters;
+struct QWebSocketThreadedMessage;
+struct QWebSocketThreadedRings;
+
+// The connection as last published by the network thread, all fields from
+// the same moment
+struct QWebSocketThreadedConnectionInfo
+{
+    QWebSocketThreadedConnectionInfo()
+        : state(QAbstractSocket::UnconnectedState),
+          error(QAbstractSocket::UnknownSocketError),
+          closeCode(QWebSocketProtocol::CloseCodeNormal),
+          peerPort(0),
+          roundTripTime(-1),
+          roundTripTimeVariation(-1)
+    {}
+
+    QAbstractSocket::SocketState state;
+    // Of the last error, UnknownSocketError if there was none
+    QAbstractSocket::SocketError error;
+    QString errorString;
+    // Of the last closed connection
+    QWebSocketProtocol::CloseCode closeCode;
+    QString closeReason;
+    // Of the current connection
+    QHostAddress peerAddress;
+    quint16 peerPort;
+    // Smoothed over the pongs of the current connection and the mean
+    // deviation from it, in nanoseconds, -1 until measured
+    qint64 roundTripTime;
+    qint64 roundTripTimeVariation;
+};
+
 class QWebSocketThreaded : public QObject
 {
     Q_OBJECT
     Q_DISABLE_COPY(QWebSocketThreaded)
 
 public:
+    enum Transport
+    {
+        // Every command and every received message is a queued signal
+        SignalTransport,
+        // Commands and received messages go through a pair of lock-free
+        // rings, an event is posted only when the other side is idle
+        RingTransport
+    };
+    Q_ENUM(Transport)
+
+    enum TextEncoding
+    {
+        // Text messages are delivered as QString
+        Utf16Text,
+        // Text messages are delivered as UTF-8 with utf8TextMessageReceived()
+        Utf8Text
+    };
+    Q_ENUM(TextEncoding)
+
+    enum BinaryFormat
+    {
+        // Binary messages are delivered as QByteArray
+        RawBinary,
+        // Binary messages are decoded on the network thread and delivered
+        // with decodedMessageReceived(), CBOR needs Qt 5.12
+        CborBinary,
+        MessagePackBinary
+    };
+    Q_ENUM(BinaryFormat)
+
+    // Only matters with a sendWindow(), see there
+    enum Priority
+    {
+        HighPriority,
+        NormalPriority,
+        LowPriority
+    };
+    Q_ENUM(Priority)
+
     explicit QWebSocketThreaded(const QString &origin = QString(),
                         QWebSocketProtocol::Version version = QWebSocketProtocol::VersionLatest,
                         QObject *parent = Q_NULLPTR);
+    // Runs on a thread of pool instead of the global one. The pool has to
+    // outlive the socket, the close handshake of destroyed sockets is cut
+    // short when it goes away.
+    explicit QWebSocketThreaded(QWebSocketThreadPool *pool, const QString &origin = QString(),
+                        QWebSocketProtocol::Version version = QWebSocketProtocol::VersionLatest,
+                        QObject *parent = Q_NULLPTR);
+    // Runs on thread, which must be running from the first open() and
+    // outlive the socket: it is destroyed there after this object
+    explicit QWebSocketThreaded(QThread *thread, const QString &origin = QString(),
+                        QWebSocketProtocol::Version version = QWebSocketProtocol::VersionLatest,
+                        QObject *parent = Q_NULLPTR);
     virtual ~QWebSocketThreaded();
 
+    // These read the snapshot published by the network thread, so they are
+    // up to date even while the queued signals are still on their way and
+    // can be called from any thread. Use connectionInfo() for several
+    // consistent fields.
     //void abort();
-    //QAbstractSocket::SocketError error() const;
+    QAbstractSocket::SocketError error() const;
     QString errorString() const;
     //bool flush();
     //bool isValid() const;
     //QHostAddress localAddress() const;
     //quint16 localPort() const;
     //QAbstractSocket::PauseModes pauseMode() const;
-    //QHostAddress peerAddress() const;
+    QHostAddress peerAddress() const;
     //QString peerName() const;
-    //quint16 peerPort() const;
+    quint16 peerPort() const;
 #ifndef QT_NO_NETWORKPROXY
     //QNetworkProxy proxy() const;
     //void setProxy(const QNetworkProxy &networkProxy);
@@ -89,11 +189,216 @@ public:
     QUrl requestUrl() const;
     //QNetworkRequest request() const;
     //QString origin() const;
-    //QWebSocketProtocol::CloseCode closeCode() const;
-    //QString closeReason() const;
+    QWebSocketProtocol::CloseCode closeCode() const;
+    QString closeReason() const;
+    QWebSocketThreadedConnectionInfo connectionInfo() const;
+
+    qint64 sendTextMessage(const QString &message, Priority priority = NormalPriority);
+    qint64 sendBinaryMessage(const QByteArray &data, Priority priority = NormalPriority);
+    // Same as sendTextMessage() for UTF-8 text, which is sent without
+    // conversion to UTF-16 with compression
+    qint64 sendTextMessageUtf8(const QByteArray &message, Priority priority = NormalPriority);
+    // Encoded with binaryFormat() on the network thread and sent as a binary
+    // message. Maps, lists, strings, byte arrays, numbers, booleans, dates
+    // and nulls can be encoded. bufferedAmount() only accounts for the
+    // message once it is encoded. Refused with a warning, returning 0, while
+    // binaryFormat() is RawBinary.
+    qint64 sendEncodedMessage(const QVariant &message, Priority priority = NormalPriority);
+
+    // Same as sendTextMessage()/sendBinaryMessage(), but return an id right
+    // away, which is reported back with messageSent() together with the size
+    // QWebSocket returned once the message is written to the network. Not
+    // reported for messages dropped because the connection closed first.
+    qint64 postTextMessage(const QString &message, Priority priority = NormalPriority);
+    qint64 postBinaryMessage(const QByteArray &data, Priority priority = NormalPriority);
+    qint64 postEncodedMessage(const QVariant &message, Priority priority = NormalPriority);
+
+    // Reusable memory for outgoing binary messages: fill a buffer acquired
+    // from the pool and post it, it goes back to the pool once the network
+    // thread wrote it and the caller dropped its copies. With RingTransport
+    // nothing is allocated on the way, the queued signal of SignalTransport
+    // still allocates its event.
+    QWebSocketThreadedBufferPool *bufferPool() const;
+    qint64 postBinaryBuffer(const QWebSocketThreadedBuffer &buffer, Priority priority = NormalPriority);
+
+    // When enabled, every received message belongs to a logical channel and
+    // is delivered with channelTextMessageReceived() or
+    // channelBinaryMessageReceived() instead. Text messages are framed as
+    // "channel:payload", binary ones start with a byte holding the length of
+    // the UTF-8 channel id followed by the id. Messages without a valid
+    // channel prefix are dropped. The routing is done by the network thread.
+    bool multiplexed() const;
+    void setMultiplexed(bool multiplexed);
+    // With multiplexed, the channels to deliver. Messages of any other
+    // channel are dropped by the network thread. Empty delivers every
+    // channel, which is the default.
+    QStringList channels() const;
+    void setChannels(const QStringList &channels);
+    // Refused with a warning if the channel id contains ':'
+    void sendChannelTextMessage(const QString &channel, const QString &message);
+    // Refused with a warning unless the UTF-8 channel id fits in 255 bytes
+    void sendChannelBinaryMessage(const QString &channel, const QByteArray &data);
 
-    qint64 sendTextMessage(const QString &message);
-    qint64 sendBinaryMessage(const QByteArray &data);
+    // Runs on the network thread for every whole received message, dropped
+    // messages never reach the GUI thread and are counted in
+    // QWebSocketThreadedStats::messagesFiltered(). Routed messages are
+    // delivered as channel messages. With multiplexed, the filter sees the
+    // payload after the channel prefix and routes are ignored. The filter
+    // can't be used by anything else once set, a null one disables filtering.
+    QSharedPointer<QWebSocketThreadedFilter> filter() const;
+    void setFilter(const QSharedPointer<QWebSocketThreadedFilter> &filter);
+
+    // Conflation: the network thread keeps only the latest message for each
+    // key given by the extractor, and the GUI thread gets the messages of the
+    // keys that changed since it last drained them, in the order they first
+    // changed. Keyed messages always go through that map, so they are not
+    // ordered with the messages without a key, and they are delivered with
+    // messagesReceived() when batching. Like the filter, the extractor runs on
+    // the network thread and a null one disables conflation.
+    QSharedPointer<QWebSocketThreadedKeyExtractor> keyExtractor() const;
+    void setKeyExtractor(const QSharedPointer<QWebSocketThreadedKeyExtractor> &keyExtractor);
+
+    // The processor gets the whole messages that passed the filter and were
+    // not routed, on the network thread, and its output is delivered with
+    // processedMessageReceived() instead, one message per value, or with
+    // messagesReceived() when batching. JSON parsing, conflation and
+    // textEncoding() don't apply to those messages. Like the filter, it is
+    // only called from the network thread once set, and a null one delivers
+    // the messages as they are again.
+    QSharedPointer<QWebSocketThreadedProcessor> processor() const;
+    void setProcessor(const QSharedPointer<QWebSocketThreadedProcessor> &processor);
+
+    // When paced, received messages of any kind wait in the queue instead of
+    // being dispatched as they arrive: messagesPending() tells that there
+    // are some, and dispatchPending() delivers them. Disabling pacing
+    // dispatches what is left right away.
+    bool paced() const;
+    void setPaced(bool paced);
+    // Dispatches queued messages until budget nanoseconds have elapsed, at
+    // least one. Returns true if some are left for the next call. With
+    // batching, the messages are delivered with one messagesReceived() call.
+    bool dispatchPending(qint64 budget);
+
+    // Bytes of the messages passed to sendTextMessage()/sendBinaryMessage()
+    // that were not yet written to the network, in the bytesWritten() unit:
+    // a message counts with its UTF-8 or binary payload when sent, and with
+    // its frame headers, after compression, once the network thread handed
+    // it to the socket. Messages dropped by a lost or closed connection leave
+    // it, the ones kept by replayMessages() only once replayed or dropped.
+    qint64 bufferedAmount() const;
+    // drained() is emitted once bufferedAmount() falls back to highWaterMark()
+    // after exceeding it
+    qint64 highWaterMark() const;
+    void setHighWaterMark(qint64 highWaterMark);
+
+    // When non-zero, the network thread hands messages to QWebSocket only
+    // while fewer than sendWindow() bytes are waiting to be written, and
+    // keeps the others in one queue per Priority, so that a message sent
+    // with HighPriority overtakes the bulk sent before it. Frames of
+    // different messages can't interleave, so it still waits for the message
+    // being written: keep bulk messages small, or split them, to bound that
+    // wait. Channel messages have NormalPriority. 0 disables the queues.
+    qint64 sendWindow() const;
+    void setSendWindow(qint64 sendWindow);
+
+    // When enabled, received messages are collected on the network thread
+    // and delivered with a single messagesReceived() per event loop turn
+    // instead of textMessageReceived()/binaryMessageReceived(). Every entry
+    // is a map with the message in "data" and its "type": "text", "utf8Text",
+    // "binary", "json" (parsed with parseJson(), text that isn't valid JSON
+    // stays "text"), "decoded" (with binaryFormat()) or "processed".
+    bool batchMessages() const;
+    void setBatchMessages(bool batchMessages);
+
+    // When enabled, text messages are parsed as JSON on the network thread
+    // and delivered with jsonMessageReceived(), those that fail to parse are
+    // still delivered as text.
+    bool parseJson() const;
+    void setParseJson(bool parseJson);
+
+    // When enabled, frames are forwarded with textFrameReceived() and
+    // binaryFrameReceived() as soon as they arrive, and the assembled
+    // messages are not delivered at all. Not while compression() is offered
+    // or in use: compressed messages only decompress whole, so they are
+    // delivered as messages.
+    bool streamFrames() const;
+    void setStreamFrames(bool streamFrames);
+
+    // When enabled, the network thread reconnects after the connection was
+    // lost or couldn't be established, until close() is called. The delay
+    // starts at minBackoff() and doubles up to maxBackoff() milliseconds,
+    // every delay is shortened by a random fraction of up to jitter().
+    // With replayMessages(), messages sent while reconnecting are kept and
+    // sent once connected again instead of being dropped, up to 65536
+    // messages or 16 MB: beyond that the oldest are dropped with a warning.
+    bool autoReconnect() const;
+    void setAutoReconnect(bool autoReconnect);
+    int minBackoff() const;
+    void setMinBackoff(int minBackoff);
+    int maxBackoff() const;
+    void setMaxBackoff(int maxBackoff);
+    double jitter() const;
+    void setJitter(double jitter);
+    bool replayMessages() const;
+    void setReplayMessages(bool replayMessages);
+
+    // Keepalive run by the network thread, so it keeps going while the GUI
+    // thread is blocked: a ping every pingInterval() milliseconds while
+    // connected, 0 disables it. A connection that doesn't answer within
+    // pongTimeout() milliseconds, 0 for no limit, is aborted with
+    // SocketTimeoutError and reconnected if autoReconnect() is set. The pong
+    // of every keepalive ping updates the round trip time in
+    // connectionInfo(), pongs of ping() and unsolicited ones don't.
+    int pingInterval() const;
+    void setPingInterval(int pingInterval);
+    int pongTimeout() const;
+    void setPongTimeout(int pongTimeout);
+
+    // When enabled, the network thread holds the messages sent within one of
+    // its event loop turns, or within coalesceDelay() milliseconds of the
+    // first one, and hands them to the socket together, so that a burst of
+    // small messages goes out in one write instead of one per message.
+    // Disabled by default, the delay defaults to 0.
+    bool coalesceSends() const;
+    void setCoalesceSends(bool coalesceSends);
+    int coalesceDelay() const;
+    void setCoalesceDelay(int coalesceDelay);
+
+    // When enabled, every message is DEFLATE compressed on the network thread
+    // like RFC 7692 does it, and sent as a binary frame starting with a type
+    // byte. QWebSocket can't negotiate extensions or set RSV1, so the server
+    // has to implement the same framing and accept the offer with its first
+    // message, "\0deflate" as binary, which the client echoes. Messages stay
+    // plain until then, and for the whole connection if the server's first
+    // message is anything else. Once accepted, binary messages starting with
+    // one of the type bytes are decompressed. Applies from the next open().
+    bool compression() const;
+    void setCompression(bool compression);
+    int compressionWindowBits() const;
+    void setCompressionWindowBits(int windowBits);
+    bool compressionContextTakeover() const;
+    void setCompressionContextTakeover(bool contextTakeover);
+
+    // Meant to be chosen before open(), messages and commands that are in
+    // flight while switching may be reordered.
+    Transport transport() const;
+    void setTransport(Transport transport);
+
+    // With Utf8Text, the network thread converts text messages to UTF-8 and
+    // the GUI thread never sees their QString. QWebSocket itself always
+    // decodes to UTF-16, so only compressed messages, which stay UTF-8 all
+    // the way, skip both conversions. Channel, routed and JSON messages are
+    // not affected.
+    TextEncoding textEncoding() const;
+    void setTextEncoding(TextEncoding textEncoding);
+    // Applies to whole binary messages that aren't routed or processed, the
+    // ones that can't be decoded are still delivered as they are. A format
+    // this Qt build doesn't support is ignored with a warning.
+    BinaryFormat binaryFormat() const;
+    void setBinaryFormat(BinaryFormat binaryFormat);
+
+    // Always collected, owned by the socket
+    QWebSocketThreadedStats *stats() const;
 
 #ifndef QT_NO_SSL
     //void ignoreSslErrors(const QList<QSslError> &errors);
@@ -106,7 +411,7 @@ public Q_SLOTS:
                const QString &reason = QString());
     void open(const QUrl &url);
     //void open(const QNetworkRequest &request);
-    //void ping(const QByteArray &payload = QByteArray());
+    void ping(const QByteArray &payload = QByteArray());
 #ifndef QT_NO_SSL
     //void ignoreSslErrors();
 #endif
@@ -120,13 +425,27 @@ Q_SIGNALS:
     //void proxyAuthenticationRequired(const QNetworkProxy &proxy, QAuthenticator *pAuthenticator);
 #endif
     //void readChannelFinished();
-    //void textFrameReceived(const QString &frame, bool isLastFrame);
-    //void binaryFrameReceived(const QByteArray &frame, bool isLastFrame);
+    void textFrameReceived(const QString &frame, bool isLastFrame);
+    void binaryFrameReceived(const QByteArray &frame, bool isLastFrame);
     void textMessageReceived(const QString &message);
+    void utf8TextMessageReceived(const QByteArray &message);
     void binaryMessageReceived(const QByteArray &message);
+    void jsonMessageReceived(const QVariant &message);
+    void processedMessageReceived(const QVariant &message);
+    void decodedMessageReceived(const QVariant &message);
+    void messagesReceived(const QVariantList &messages);
+    void messagesPending();
+    void channelTextMessageReceived(const QString &channel, const QString &message);
+    void channelBinaryMessageReceived(const QString &channel, const QByteArray &message);
     void error(QAbstractSocket::SocketError error);
-    //void pong(quint64 elapsedTime, const QByteArray &payload);
-    //void bytesWritten(qint64 bytes);
+    void pong(quint64 elapsedTime, const QByteArray &payload);
+    void bytesWritten(qint64 bytes);
+    void messageSent(qint64 messageId, qint64 bytes);
+    void bufferedAmountChanged(qint64 bufferedAmount);
+    void drained();
+    // The snapshot behind connectionInfo() changed, emitted once for any
+    // number of changes published before the GUI thread got to it
+    void connectionInfoChanged();
 
 #ifndef QT_NO_SSL
     //void sslErrors(const QList<QSslError> &errors);
@@ -137,21 +456,116 @@ public Q_SLOTS:
     void connectedHandler();
     void disconnectedHandler();
     void stateChangedHandler(QAbstractSocket::SocketState state);
-    void textMessageReceivedHandler(const QString &message);
-    void binaryMessageReceivedHandler(const QByteArray &message);
+    void textFrameReceivedHandler(const QString &frame, bool isLastFrame, qint64 receivedAt);
+    void binaryFrameReceivedHandler(const QByteArray &frame, bool isLastFrame, qint64 receivedAt);
+    void textMessageReceivedHandler(const QString &message, qint64 receivedAt);
+    void utf8TextMessageReceivedHandler(const QByteArray &message, qint64 receivedAt);
+    void binaryMessageReceivedHandler(const QByteArray &message, qint64 receivedAt);
+    void jsonMessageReceivedHandler(const QVariant &message, qint64 receivedAt);
+    void processedMessageReceivedHandler(const QVariant &message, qint64 receivedAt);
+    void decodedMessageReceivedHandler(const QVariant &message, qint64 receivedAt);
+    void channelTextMessageReceivedHandler(const QString &channel, const QString &message, qint64 receivedAt);
+    void channelBinaryMessageReceivedHandler(const QString &channel, const QByteArray &message, qint64 receivedAt);
     void errorHandler(QAbstractSocket::SocketError error);
+    void messagesQueuedHandler();
+    void messagesPushedHandler();
+    void bytesWrittenHandler(qint64 bytes);
+    void messageSentHandler(qint64 messageId, qint64 bytes);
+    void bufferedAmountAdjustedHandler(qint64 delta);
+    void connectionInfoChangedHandler();
+    void pongHandler(quint64 elapsedTime, const QByteArray &payload);
 
 Q_SIGNALS:
     void closeCommand(QWebSocketProtocol::CloseCode closeCode, const QString &reason);
     void openCommand(const QUrl &url);
-    void sendTextMessageCommand(const QString &message);
-    void sendBinaryMessageCommand(const QByteArray &data);
+    void shutdownCommand();
+    void sendTextMessageCommand(const QString &message, qint64 messageId, int priority);
+    void sendUtf8TextMessageCommand(const QByteArray &message, qint64 messageId, int priority);
+    void sendBinaryMessageCommand(const QByteArray &data, qint64 messageId, int priority);
+    void sendBinaryBufferCommand(const QWebSocketThreadedBuffer &buffer, qint64 messageId, int priority);
+    void sendEncodedMessageCommand(const QVariant &message, qint64 messageId, int priority);
+    void setBatchMessagesCommand(bool batchMessages);
+    void setParseJsonCommand(bool parseJson);
+    void setStreamFramesCommand(bool streamFrames);
+    void setMultiplexedCommand(bool multiplexed);
+    void setChannelsCommand(const QStringList &channels);
+    void setFilterCommand(const QSharedPointer<QWebSocketThreadedFilter> &filter);
+    void setKeyExtractorCommand(const QSharedPointer<QWebSocketThreadedKeyExtractor> &keyExtractor);
+    void setProcessorCommand(const QSharedPointer<QWebSocketThreadedProcessor> &processor);
+    void setPacedCommand(bool paced);
+    void setUtf8TextCommand(bool utf8Text);
+    void setBinaryFormatCommand(int binaryFormat);
+    void setSendWindowCommand(qint64 sendWindow);
+    void sendChannelTextMessageCommand(const QString &channel, const QString &message);
+    void sendChannelBinaryMessageCommand(const QString &channel, const QByteArray &data);
+    void setCompressionCommand(bool compression, int windowBits, bool contextTakeover);
+    void setKeepaliveCommand(int pingInterval, int pongTimeout);
+    void setCoalescingCommand(bool coalesceSends, int coalesceDelay);
+    void pingCommand(const QByteArray &payload);
+    void setReconnectPolicyCommand(bool autoReconnect, int minBackoff, int maxBackoff, double jitter,
+                                   bool replayMessages);
+    void setRingTransportCommand(const QSharedPointer<QWebSocketThreadedRings> &rings);
+    void commandsPushedCommand();
 
 private:
-    QThread m_thread;
-    QString m_errorString;
+    QWebSocketThreaded(QWebSocketThreadPool *pool, QThread *thread, const QString &origin,
+                       QWebSocketProtocol::Version version, QObject *parent);
+
+    // Null when running on a thread of the caller
+    QWebSocketThreadPool *m_pool;
+    // The worker lives on the GUI thread until the first open(), a thread
+    // of m_pool is only acquired then
+    QThread *m_thread;
+    QWebSocketThreadedWorker *m_worker;
+    QSharedPointer<QWebSocketThreadedQueue> m_queue;
+    QSharedPointer<QWebSocketThreadedCounters> m_counters;
+    QSharedPointer<QWebSocketThreadedSnapshot> m_snapshot;
+    QWebSocketThreadedStats *m_stats;
+    bool m_batchMessages;
+    bool m_parseJson;
+    bool m_streamFrames;
+    bool m_multiplexed;
+    QStringList m_channels;
+    bool m_paced;
+    QSharedPointer<QWebSocketThreadedFilter> m_filter;
+    QSharedPointer<QWebSocketThreadedKeyExtractor> m_keyExtractor;
+    QSharedPointer<QWebSocketThreadedProcessor> m_processor;
+    bool m_compression;
+    int m_compressionWindowBits;
+    bool m_compressionContextTakeover;
+    bool m_autoReconnect;
+    int m_minBackoff;
+    int m_maxBackoff;
+    double m_jitter;
+    bool m_replayMessages;
+    int m_pingInterval;
+    int m_pongTimeout;
+    bool m_coalesceSends;
+    int m_coalesceDelay;
+    Transport m_transport;
+    TextEncoding m_textEncoding;
+    BinaryFormat m_binaryFormat;
+    QSharedPointer<QWebSocketThreadedRings> m_rings;
+    QSharedPointer<QWebSocketThreadedBufferPool> m_bufferPool;
     QUrl m_url;
-    QAbstractSocket::SocketState m_state;
+    qint64 m_bufferedAmount;
+    qint64 m_highWaterMark;
+    qint64 m_sendWindow;
+    // Posted messages count up from 1, sent ones get the negated id so
+    // that traces can still tell them apart
+    qint64 m_lastMessageId;
+    // Taken from m_queue, dispatched up to m_pendingIndex
+    QVector<QWebSocketThreadedMessage> m_pending;
+    int m_pendingIndex;
+
+    void setBufferedAmount(qint64 bufferedAmount);
+    void updateReconnectPolicy();
+    void pushCommand(const QWebSocketThreadedCommand &command);
+    void moveWorkerToThread();
+    void queueTextMessage(const QString &message, qint64 messageId, Priority priority);
+    void queueBinaryMessage(const QByteArray &data, qint64 messageId, Priority priority);
+    void queueEncodedMessage(const QVariant &message, qint64 messageId, Priority priority);
+    void dispatch(const QWebSocketThreadedMessage &message);
 };
 
 #endif // QWEBSOCKETTHREADED_H
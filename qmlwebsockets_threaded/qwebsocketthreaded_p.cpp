@@ -0,0 +1,1513 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreaded_p.h"
+#include "qwebsocketthreadedcodec_p.h"
+#include "qwebsocketthreadeddeflate_p.h"
+#include "qwebsocketthreadedtrace_p.h"
+
+#include <QJsonDocument>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+// The server's first message when it accepts the compression offer, which
+// the client echoes before its first compressed message
+static QByteArray compressionAccepted()
+{
+    return QByteArrayLiteral("\x00" "deflate");
+}
+
+qint64 qWebSocketThreadedUtf8Size(const QString &text)
+{
+    const ushort *data = text.utf16();
+    const int length = text.size();
+    qint64 size = 0;
+    for (int i = 0; i < length; ++i) {
+        const ushort c = data[i];
+        if (c < 0x80) {
+            size += 1;
+        } else if (c < 0x800) {
+            size += 2;
+        } else if (QChar::isHighSurrogate(c) && i + 1 < length && QChar::isLowSurrogate(data[i + 1])) {
+            size += 4;
+            ++i;
+        } else {
+            size += 3;
+        }
+    }
+    return size;
+}
+
+// What the GUI thread added to bufferedAmount for a send command still
+// waiting to be written
+static qint64 payloadSize(const QWebSocketThreadedCommand &command)
+{
+    switch (command.type) {
+    case QWebSocketThreadedCommand::SendText:
+        return qWebSocketThreadedUtf8Size(command.text);
+    case QWebSocketThreadedCommand::SendUtf8Text:
+    case QWebSocketThreadedCommand::SendBinary:
+        return command.data.size();
+    case QWebSocketThreadedCommand::SendBuffer:
+        return command.buffer.size();
+    case QWebSocketThreadedCommand::Close:
+    case QWebSocketThreadedCommand::Open:
+    case QWebSocketThreadedCommand::SendChannelText:
+    case QWebSocketThreadedCommand::SendChannelBinary:
+    case QWebSocketThreadedCommand::SendEncoded:
+        break;
+    }
+    return 0;
+}
+
+// Wire size of a received data frame, server frames are not masked
+static qint64 receivedFrameSize(qint64 payload)
+{
+    return 2 + (payload > 0xffff ? 8 : payload > 125 ? 2 : 0) + payload;
+}
+
+void QWebSocketThreadedCounters::received(qint64 bytes, bool isLastFrame)
+{
+    bytesIn.fetchAndAddRelaxed(bytes);
+    if (isLastFrame) {
+        messagesIn.fetchAndAddRelaxed(1);
+    }
+}
+
+void QWebSocketThreadedCounters::sent()
+{
+    messagesOut.fetchAndAddRelaxed(1);
+}
+
+void QWebSocketThreadedCounters::filtered()
+{
+    messagesFiltered.fetchAndAddRelaxed(1);
+}
+
+void QWebSocketThreadedCounters::conflated()
+{
+    messagesConflated.fetchAndAddRelaxed(1);
+    queueDepth.fetchAndAddRelaxed(-1);
+}
+
+void QWebSocketThreadedCounters::queued()
+{
+    const int depth = queueDepth.fetchAndAddRelaxed(1) + 1;
+    int max = maxQueueDepth.loadAcquire();
+    while (depth > max && !maxQueueDepth.testAndSetOrdered(max, depth, max)) {
+    }
+}
+
+void QWebSocketThreadedCounters::dispatched(qint64 receivedAt)
+{
+    Q_TRACE(QWebSocketThreaded_dequeued, this, receivedAt);
+    queueDepth.fetchAndAddRelaxed(-1);
+    int bucket = 0;
+    for (qint64 us = (now() - receivedAt) / 1000; us > 0 && bucket < LatencyBuckets - 1; us >>= 1) {
+        ++bucket;
+    }
+    dispatchLatency[bucket].fetchAndAddRelaxed(1);
+}
+
+bool QWebSocketThreadedQueue::enqueue(const QWebSocketThreadedMessage &message)
+{
+    QMutexLocker locker(&m_mutex);
+    m_messages.append(message);
+    return m_messages.size() == 1;
+}
+
+bool QWebSocketThreadedQueue::enqueue(const QString &key, const QWebSocketThreadedMessage &message,
+                                      bool *replaced)
+{
+    QMutexLocker locker(&m_mutex);
+    const QHash<QString, int>::const_iterator it = m_keys.constFind(key);
+    *replaced = it != m_keys.constEnd();
+    if (*replaced) {
+        m_messages[it.value()] = message;
+        return false;
+    }
+    m_keys.insert(key, m_messages.size());
+    m_messages.append(message);
+    return m_messages.size() == 1;
+}
+
+QVector<QWebSocketThreadedMessage> QWebSocketThreadedQueue::takeAll()
+{
+    QVector<QWebSocketThreadedMessage> messages;
+    QMutexLocker locker(&m_mutex);
+    messages.swap(m_messages);
+    m_keys.clear();
+    return messages;
+}
+
+QWebSocketThreadedSnapshot::QWebSocketThreadedSnapshot()
+    : m_state(QAbstractSocket::UnconnectedState),
+      m_error(QAbstractSocket::UnknownSocketError),
+      m_notifyPending(0)
+{
+}
+
+QAbstractSocket::SocketState QWebSocketThreadedSnapshot::state() const
+{
+    return QAbstractSocket::SocketState(m_state.loadAcquire());
+}
+
+QAbstractSocket::SocketError QWebSocketThreadedSnapshot::error() const
+{
+    return QAbstractSocket::SocketError(m_error.loadAcquire());
+}
+
+QWebSocketThreadedConnectionInfo QWebSocketThreadedSnapshot::info() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_info;
+}
+
+bool QWebSocketThreadedSnapshot::publish(const QWebSocketThreadedConnectionInfo &info)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_info = info;
+    }
+    m_state.storeRelease(info.state);
+    m_error.storeRelease(info.error);
+    return m_notifyPending.testAndSetOrdered(0, 1);
+}
+
+void QWebSocketThreadedSnapshot::notified()
+{
+    m_notifyPending.storeRelease(0);
+}
+
+// RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF
+static bool isValidUtf8(const QByteArray &data)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *end = p + data.size();
+    while (p < end) {
+        // ASCII a word at a time
+        while (end - p >= 8) {
+            quint64 word;
+            memcpy(&word, p, sizeof(word));
+            if (word & Q_UINT64_C(0x8080808080808080)) {
+                break;
+            }
+            p += 8;
+        }
+        if (p == end) {
+            break;
+        }
+        if (*p < 0x80) {
+            ++p;
+            continue;
+        }
+        int length;
+        uint codePoint;
+        uint minimum;
+        if ((*p & 0xe0) == 0xc0) {
+            length = 2;
+            codePoint = *p & 0x1f;
+            minimum = 0x80;
+        } else if ((*p & 0xf0) == 0xe0) {
+            length = 3;
+            codePoint = *p & 0x0f;
+            minimum = 0x800;
+        } else if ((*p & 0xf8) == 0xf0) {
+            length = 4;
+            codePoint = *p & 0x07;
+            minimum = 0x10000;
+        } else {
+            return false;
+        }
+        if (end - p < length) {
+            return false;
+        }
+        for (int i = 1; i < length; ++i) {
+            if ((p[i] & 0xc0) != 0x80) {
+                return false;
+            }
+            codePoint = (codePoint << 6) | (p[i] & 0x3f);
+        }
+        if (codePoint < minimum || codePoint > 0x10ffff
+                || (codePoint >= 0xd800 && codePoint <= 0xdfff)) {
+            return false;
+        }
+        p += length;
+    }
+    return true;
+}
+
+QWebSocketThreadedWorker::QWebSocketThreadedWorker(const QString &origin,
+                                                   QWebSocketProtocol::Version version,
+                                                   const QSharedPointer<QWebSocketThreadedQueue> &queue,
+                                                   const QSharedPointer<QWebSocketThreadedCounters> &counters,
+                                                   const QSharedPointer<QWebSocketThreadedSnapshot> &snapshot)
+    : QObject(),
+      m_webSocket(new QWebSocket(origin, version, this)),
+      m_queue(queue),
+      m_counters(counters),
+      m_snapshot(snapshot),
+      m_info(),
+      m_hasConnected(false),
+      m_batchMessages(false),
+      m_parseJson(false),
+      m_streamFrames(false),
+      m_multiplexed(false),
+      m_channels(),
+      m_paced(false),
+      m_utf8Text(false),
+      m_binaryFormat(QWebSocketThreadedCodec::Raw),
+      m_sendWindow(0),
+      m_bytesInFlight(0),
+      m_bytesHandedOver(0),
+      m_bytesWrittenOut(0),
+      m_pendingSent(),
+      m_coalesceSends(false),
+      m_coalesced(),
+      m_coalesceTimer(new QTimer(this)),
+      m_filter(),
+      m_keyExtractor(),
+      m_processor(),
+      m_compression(false),
+      m_compressionWindowBits(15),
+      m_compressionContextTakeover(true),
+      m_compressionPending(false),
+      m_compressionActive(false),
+      m_rings(),
+      m_ringTransport(false),
+      m_reconnectTimer(new QTimer(this)),
+      m_closeRequested(true),
+      m_autoReconnect(false),
+      m_minBackoff(1000),
+      m_maxBackoff(30000),
+      m_jitter(0.5),
+      m_replayMessages(false),
+      m_reconnectAttempt(0),
+      m_replayBytes(0),
+      m_pingTimer(new QTimer(this)),
+      m_pongTimer(new QTimer(this)),
+      m_pingSentAt(-1),
+      m_pingPayload(),
+      m_pingSequence(0),
+      m_smoothedRoundTripTime(-1),
+      m_roundTripTimeVariation(-1),
+      m_lastReceivedAt(-1)
+{
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &QWebSocketThreadedWorker::onReconnectTimeout);
+    m_coalesceTimer->setSingleShot(true);
+    m_coalesceTimer->setInterval(0);
+    connect(m_coalesceTimer, &QTimer::timeout, this, &QWebSocketThreadedWorker::onCoalesceTimeout);
+    connect(m_pingTimer, &QTimer::timeout, this, &QWebSocketThreadedWorker::onPingTimeout);
+    m_pongTimer->setSingleShot(true);
+    m_pongTimer->setInterval(10000);
+    connect(m_pongTimer, &QTimer::timeout, this, &QWebSocketThreadedWorker::onPongTimeout);
+    connect(m_webSocket, &QWebSocket::pong, this, &QWebSocketThreadedWorker::onPong);
+
+    connect(m_webSocket, &QWebSocket::connected, this, &QWebSocketThreadedWorker::onConnected);
+    connect(m_webSocket, &QWebSocket::disconnected, this, &QWebSocketThreadedWorker::disconnected);
+    connect(m_webSocket, &QWebSocket::stateChanged, this, &QWebSocketThreadedWorker::onStateChanged);
+    connect(m_webSocket, &QWebSocket::textFrameReceived,
+            this, &QWebSocketThreadedWorker::onTextFrameReceived);
+    connect(m_webSocket, &QWebSocket::binaryFrameReceived,
+            this, &QWebSocketThreadedWorker::onBinaryFrameReceived);
+    connect(m_webSocket, &QWebSocket::textMessageReceived,
+            this, &QWebSocketThreadedWorker::onTextMessageReceived);
+    connect(m_webSocket, &QWebSocket::binaryMessageReceived,
+            this, &QWebSocketThreadedWorker::onBinaryMessageReceived);
+    connect(m_webSocket,
+            static_cast<void (QWebSocket::*)(QAbstractSocket::SocketError)>(&QWebSocket::error),
+            this,
+            &QWebSocketThreadedWorker::onError);
+    connect(m_webSocket, &QWebSocket::bytesWritten, this, &QWebSocketThreadedWorker::onBytesWritten);
+}
+
+QWebSocketThreadedWorker::~QWebSocketThreadedWorker()
+{
+}
+
+void QWebSocketThreadedWorker::close(QWebSocketProtocol::CloseCode closeCode, const QString &reason)
+{
+    // Sent before close(), so they go before the close frame
+    writeCoalesced();
+    m_closeRequested = true;
+    m_reconnectTimer->stop();
+    clearReplay();
+    m_webSocket->close(closeCode, reason);
+}
+
+void QWebSocketThreadedWorker::shutdown()
+{
+    writeCoalesced();
+    m_closeRequested = true;
+    m_reconnectTimer->stop();
+    m_pingTimer->stop();
+    m_pongTimer->stop();
+    clearReplay();
+    for (QVector<QWebSocketThreadedCommand> &outgoing : m_outgoing) {
+        outgoing.clear();
+    }
+    switch (m_webSocket->state()) {
+    case QAbstractSocket::UnconnectedState:
+        deleteLater();
+        return;
+    case QAbstractSocket::ConnectedState:
+        m_webSocket->close(QWebSocketProtocol::CloseCodeGoingAway);
+        break;
+    case QAbstractSocket::ClosingState:
+        break;
+    case QAbstractSocket::HostLookupState:
+    case QAbstractSocket::ConnectingState:
+    case QAbstractSocket::BoundState:
+    case QAbstractSocket::ListeningState:
+        // Nothing to close gracefully yet
+        m_webSocket->abort();
+        deleteLater();
+        return;
+    }
+    connect(m_webSocket, &QWebSocket::disconnected, this, &QObject::deleteLater);
+    // Servers that never answer the close frame
+    QTimer::singleShot(ShutdownTimeout, this, &QWebSocketThreadedWorker::onShutdownTimeout);
+}
+
+void QWebSocketThreadedWorker::abortShutdown()
+{
+    m_webSocket->abort();
+    deleteLater();
+}
+
+void QWebSocketThreadedWorker::open(const QUrl &url)
+{
+    m_url = url;
+    m_closeRequested = false;
+    m_reconnectAttempt = 0;
+    m_reconnectTimer->stop();
+    connectToServer();
+}
+
+void QWebSocketThreadedWorker::connectToServer()
+{
+    // Every connection starts with fresh compression contexts, and plain
+    // until the server accepts the offer
+    m_deflate.reset();
+    m_compressionPending = false;
+    m_compressionActive = false;
+    if (!m_compression) {
+        m_webSocket->open(m_url);
+        return;
+    }
+    m_deflate.reset(new QWebSocketThreadedDeflate(m_compressionWindowBits,
+                                                  m_compressionContextTakeover));
+    if (!m_deflate->isValid()) {
+        qWarning("QWebSocketThreaded: zlib failed to initialize, connecting without compression");
+        m_deflate.reset();
+        m_webSocket->open(m_url);
+        return;
+    }
+    m_compressionPending = true;
+    QByteArray offer = "deflate; window_bits=" + QByteArray::number(m_compressionWindowBits);
+    if (!m_compressionContextTakeover) {
+        offer += "; no_context_takeover";
+    }
+    QNetworkRequest request(m_url);
+    request.setRawHeader("X-WebSocket-Compression", offer);
+    m_webSocket->open(request);
+}
+
+void QWebSocketThreadedWorker::sendTextMessage(const QString &message, qint64 messageId, int priority)
+{
+    QWebSocketThreadedCommand command;
+    command.type = QWebSocketThreadedCommand::SendText;
+    command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+    command.text = message;
+    command.messageId = messageId;
+    command.priority = priority;
+    send(command);
+}
+
+void QWebSocketThreadedWorker::sendUtf8TextMessage(const QByteArray &message, qint64 messageId, int priority)
+{
+    QWebSocketThreadedCommand command;
+    command.type = QWebSocketThreadedCommand::SendUtf8Text;
+    command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+    command.data = message;
+    command.messageId = messageId;
+    command.priority = priority;
+    send(command);
+}
+
+void QWebSocketThreadedWorker::sendBinaryMessage(const QByteArray &data, qint64 messageId, int priority)
+{
+    QWebSocketThreadedCommand command;
+    command.type = QWebSocketThreadedCommand::SendBinary;
+    command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+    command.data = data;
+    command.messageId = messageId;
+    command.priority = priority;
+    send(command);
+}
+
+void QWebSocketThreadedWorker::sendBinaryBuffer(const QWebSocketThreadedBuffer &buffer, qint64 messageId, int priority)
+{
+    QWebSocketThreadedCommand command;
+    command.type = QWebSocketThreadedCommand::SendBuffer;
+    command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+    command.buffer = buffer;
+    command.messageId = messageId;
+    command.priority = priority;
+    send(command);
+}
+
+void QWebSocketThreadedWorker::sendEncodedMessage(const QVariant &message, qint64 messageId, int priority)
+{
+    QWebSocketThreadedCommand command;
+    command.type = QWebSocketThreadedCommand::SendBinary;
+    command.closeCode = QWebSocketProtocol::CloseCodeNormal;
+    command.data = QWebSocketThreadedCodec::encode(m_binaryFormat, message);
+    command.messageId = messageId;
+    command.priority = priority;
+    // The GUI thread couldn't account for it
+    Q_EMIT bufferedAmountAdjusted(command.data.size());
+    send(command);
+}
+
+void QWebSocketThreadedWorker::sendChannelTextMessage(const QString &channel, const QString &message)
+{
+    sendTextMessage(channel + QLatin1Char(':') + message, 0, NormalPriority);
+}
+
+void QWebSocketThreadedWorker::sendChannelBinaryMessage(const QString &channel, const QByteArray &data)
+{
+    const QByteArray id = channel.toUtf8();
+    QByteArray framed;
+    framed.reserve(1 + id.size() + data.size());
+    framed.append(char(id.size()));
+    framed.append(id);
+    framed.append(data);
+    sendBinaryMessage(framed, 0, NormalPriority);
+}
+
+void QWebSocketThreadedWorker::send(const QWebSocketThreadedCommand &command)
+{
+    if (m_coalesceSends) {
+        m_coalesced.append(command);
+        if (!m_coalesceTimer->isActive()) {
+            m_coalesceTimer->start();
+        }
+        return;
+    }
+    sendNow(command);
+}
+
+void QWebSocketThreadedWorker::sendNow(const QWebSocketThreadedCommand &command)
+{
+    if (isReconnecting() && m_replayMessages) {
+        keepForReplay(QVector<QWebSocketThreadedCommand>() << command, false);
+        return;
+    }
+    if (m_sendWindow > 0 && (m_bytesInFlight >= m_sendWindow || hasOutgoing())) {
+        Q_TRACE(QWebSocketThreaded_send_queued, m_counters.data(), command.messageId, command.priority);
+        m_outgoing[qBound(0, command.priority, PriorityCount - 1)].append(command);
+        return;
+    }
+    write(command);
+}
+
+void QWebSocketThreadedWorker::writeCoalesced()
+{
+    m_coalesceTimer->stop();
+    if (m_coalesced.isEmpty()) {
+        return;
+    }
+    QVector<QWebSocketThreadedCommand> coalesced;
+    coalesced.swap(m_coalesced);
+    for (const QWebSocketThreadedCommand &command : qAsConst(coalesced)) {
+        sendNow(command);
+    }
+    // QWebSocket frames into the write buffer of its TCP or TLS socket, which
+    // holds the whole batch now: write it out at once rather than on the next
+    // write notification, after more commands may have trickled in one by one
+    if (m_webSocket->state() == QAbstractSocket::ConnectedState) {
+        m_webSocket->flush();
+    }
+}
+
+bool QWebSocketThreadedWorker::hasOutgoing() const
+{
+    for (const QVector<QWebSocketThreadedCommand> &outgoing : m_outgoing) {
+        if (!outgoing.isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void QWebSocketThreadedWorker::writeOutgoing()
+{
+    // Highest priority first, and in order within a priority. QWebSocket
+    // writes all the frames of a message at once and frames of different
+    // messages can't interleave, so message boundaries are the only points
+    // where a more urgent message can get ahead.
+    int priority = 0;
+    while ((m_sendWindow == 0 || m_bytesInFlight < m_sendWindow) && priority < PriorityCount) {
+        QVector<QWebSocketThreadedCommand> &outgoing = m_outgoing[priority];
+        if (outgoing.isEmpty()) {
+            ++priority;
+            continue;
+        }
+        const QWebSocketThreadedCommand command = outgoing.takeFirst();
+        write(command);
+    }
+}
+
+void QWebSocketThreadedWorker::write(const QWebSocketThreadedCommand &command)
+{
+    qint64 bytes = 0;
+    // What the GUI thread added to bufferedAmount: the payload, in bytes
+    qint64 accounted = 0;
+    QByteArray payload;
+    switch (command.type) {
+    case QWebSocketThreadedCommand::SendText:
+        if (m_compressionActive) {
+            const QByteArray text = command.text.toUtf8();
+            accounted = text.size();
+            if (!compress(CompressedText, text, &payload)) {
+                // Never sent
+                Q_EMIT bufferedAmountAdjusted(-accounted);
+                return;
+            }
+            bytes = m_webSocket->sendBinaryMessage(payload);
+        } else {
+            accounted = qWebSocketThreadedUtf8Size(command.text);
+            bytes = m_webSocket->sendTextMessage(command.text);
+        }
+        break;
+    case QWebSocketThreadedCommand::SendUtf8Text:
+        accounted = command.data.size();
+        if (m_compressionActive) {
+            if (!compress(CompressedText, command.data, &payload)) {
+                Q_EMIT bufferedAmountAdjusted(-accounted);
+                return;
+            }
+            bytes = m_webSocket->sendBinaryMessage(payload);
+        } else {
+            // QWebSocket only takes QString and encodes it back
+            bytes = m_webSocket->sendTextMessage(QString::fromUtf8(command.data));
+        }
+        break;
+    case QWebSocketThreadedCommand::SendBinary:
+    case QWebSocketThreadedCommand::SendBuffer: {
+        // No copy for buffers: QWebSocket masks client frames into its own
+        // copy, and nothing refers to the raw data once the call returns
+        const QByteArray data = command.type == QWebSocketThreadedCommand::SendBuffer
+                ? QByteArray::fromRawData(command.buffer.constData(), command.buffer.size())
+                : command.data;
+        accounted = data.size();
+        if (m_compressionActive) {
+            if (!compress(CompressedBinary, data, &payload)) {
+                Q_EMIT bufferedAmountAdjusted(-accounted);
+                return;
+            }
+            bytes = m_webSocket->sendBinaryMessage(payload);
+        } else {
+            bytes = m_webSocket->sendBinaryMessage(data);
+        }
+        break;
+    }
+    case QWebSocketThreadedCommand::Close:
+    case QWebSocketThreadedCommand::Open:
+    case QWebSocketThreadedCommand::SendChannelText:
+    case QWebSocketThreadedCommand::SendChannelBinary:
+    case QWebSocketThreadedCommand::SendEncoded:
+        // Never queued, these are handled before they get here
+        break;
+    }
+    m_counters->sent();
+    // From here on bufferedAmount counts what goes on the wire, which is
+    // what bytesWritten() takes off again. Nothing is written while not
+    // connected.
+    const qint64 wire = m_webSocket->state() == QAbstractSocket::ConnectedState
+            ? wireSize(qMax<qint64>(0, bytes)) : 0;
+    if (wire != accounted) {
+        Q_EMIT bufferedAmountAdjusted(wire - accounted);
+    }
+    m_bytesInFlight += wire;
+    m_bytesHandedOver += wire;
+    Q_TRACE(QWebSocketThreaded_send_written, m_counters.data(), command.messageId, bytes);
+    // Reported once written, a message dropped without a connection never is
+    if (command.messageId > 0 && wire > 0) {
+        const PendingSent pending = { command.messageId, bytes, m_bytesHandedOver };
+        m_pendingSent.append(pending);
+    }
+}
+
+void QWebSocketThreadedWorker::setBatchMessages(bool batchMessages)
+{
+    m_batchMessages = batchMessages;
+}
+
+void QWebSocketThreadedWorker::setParseJson(bool parseJson)
+{
+    m_parseJson = parseJson;
+}
+
+void QWebSocketThreadedWorker::setStreamFrames(bool streamFrames)
+{
+    m_streamFrames = streamFrames;
+}
+
+void QWebSocketThreadedWorker::setMultiplexed(bool multiplexed)
+{
+    m_multiplexed = multiplexed;
+}
+
+void QWebSocketThreadedWorker::setChannels(const QStringList &channels)
+{
+    m_channels.clear();
+    for (const QString &channel : channels) {
+        m_channels.insert(channel);
+    }
+}
+
+void QWebSocketThreadedWorker::setFilter(const QSharedPointer<QWebSocketThreadedFilter> &filter)
+{
+    m_filter = filter;
+}
+
+void QWebSocketThreadedWorker::setKeyExtractor(const QSharedPointer<QWebSocketThreadedKeyExtractor> &keyExtractor)
+{
+    m_keyExtractor = keyExtractor;
+}
+
+void QWebSocketThreadedWorker::setProcessor(const QSharedPointer<QWebSocketThreadedProcessor> &processor)
+{
+    m_processor = processor;
+}
+
+void QWebSocketThreadedWorker::setPaced(bool paced)
+{
+    m_paced = paced;
+}
+
+void QWebSocketThreadedWorker::setUtf8Text(bool utf8Text)
+{
+    m_utf8Text = utf8Text;
+}
+
+void QWebSocketThreadedWorker::setBinaryFormat(int binaryFormat)
+{
+    m_binaryFormat = binaryFormat;
+}
+
+void QWebSocketThreadedWorker::setSendWindow(qint64 sendWindow)
+{
+    m_sendWindow = qMax<qint64>(0, sendWindow);
+    writeOutgoing();
+}
+
+void QWebSocketThreadedWorker::setCompression(bool compression, int windowBits, bool contextTakeover)
+{
+    m_compression = compression;
+    m_compressionWindowBits = qBound(9, windowBits, 15);
+    m_compressionContextTakeover = contextTakeover;
+}
+
+void QWebSocketThreadedWorker::setCoalescing(bool coalesce, int delay)
+{
+    m_coalesceSends = coalesce;
+    m_coalesceTimer->setInterval(qMax(0, delay));
+    if (!coalesce) {
+        writeCoalesced();
+    }
+}
+
+void QWebSocketThreadedWorker::setKeepalive(int pingInterval, int pongTimeout)
+{
+    m_pingTimer->setInterval(qMax(0, pingInterval));
+    m_pongTimer->setInterval(qMax(0, pongTimeout));
+    if (pingInterval > 0 && m_webSocket->state() == QAbstractSocket::ConnectedState) {
+        m_pingTimer->start();
+    } else {
+        m_pingTimer->stop();
+    }
+    if (pongTimeout <= 0) {
+        m_pongTimer->stop();
+    }
+}
+
+void QWebSocketThreadedWorker::ping(const QByteArray &payload)
+{
+    if (m_webSocket->state() == QAbstractSocket::ConnectedState) {
+        // Written like any frame, bytesWritten() takes it off again
+        const qint64 wire = wireSize(payload.size());
+        m_bytesInFlight += wire;
+        m_bytesHandedOver += wire;
+        Q_EMIT bufferedAmountAdjusted(wire);
+    }
+    m_webSocket->ping(payload);
+}
+
+void QWebSocketThreadedWorker::onPingTimeout()
+{
+    // One ping in flight at a time, the pong timer takes care of late ones
+    if (m_pongTimer->isActive()) {
+        return;
+    }
+    // Numbered so that only its own pong counts towards the round trip time
+    m_pingPayload = QByteArray::number(++m_pingSequence);
+    m_pingSentAt = m_counters->now();
+    ping(m_pingPayload);
+    if (m_pongTimer->interval() > 0) {
+        m_pongTimer->start();
+    }
+}
+
+void QWebSocketThreadedWorker::onPongTimeout()
+{
+    // The closing handshake would wait for the same dead link
+    m_info.error = QAbstractSocket::SocketTimeoutError;
+    m_info.errorString = tr("No pong received within %1 ms").arg(m_pongTimer->interval());
+    publish();
+    Q_EMIT error(QAbstractSocket::SocketTimeoutError);
+    m_webSocket->abort();
+}
+
+void QWebSocketThreadedWorker::onPong(quint64 elapsedTime, const QByteArray &payload)
+{
+    if (m_pingSentAt < 0 || payload != m_pingPayload) {
+        // Answers ping(), or was never asked for
+        Q_EMIT pong(elapsedTime, payload);
+        return;
+    }
+    m_pongTimer->stop();
+    const qint64 sample = m_counters->now() - m_pingSentAt;
+    m_pingSentAt = -1;
+    if (m_smoothedRoundTripTime < 0) {
+        m_smoothedRoundTripTime = sample;
+        m_roundTripTimeVariation = sample / 2;
+    } else {
+        m_roundTripTimeVariation += (qAbs(m_smoothedRoundTripTime - sample) - m_roundTripTimeVariation) / 4;
+        m_smoothedRoundTripTime += (sample - m_smoothedRoundTripTime) / 8;
+    }
+    m_info.roundTripTime = m_smoothedRoundTripTime;
+    m_info.roundTripTimeVariation = m_roundTripTimeVariation;
+    publish();
+    Q_EMIT pong(elapsedTime, payload);
+}
+
+void QWebSocketThreadedWorker::setReconnectPolicy(bool autoReconnect, int minBackoff, int maxBackoff,
+                                                  double jitter, bool replayMessages)
+{
+    m_autoReconnect = autoReconnect;
+    m_minBackoff = qMax(0, minBackoff);
+    m_maxBackoff = qMax(m_minBackoff, maxBackoff);
+    m_jitter = qBound(0.0, jitter, 1.0);
+    m_replayMessages = replayMessages;
+    if (!m_autoReconnect) {
+        m_reconnectTimer->stop();
+        clearReplay();
+    }
+}
+
+void QWebSocketThreadedWorker::setRingTransport(const QSharedPointer<QWebSocketThreadedRings> &rings)
+{
+    if (rings) {
+        m_rings = rings;
+    }
+    m_ringTransport = !rings.isNull();
+}
+
+void QWebSocketThreadedWorker::processCommands()
+{
+    if (!m_rings) {
+        return;
+    }
+    QWebSocketThreadedCommand command;
+    do {
+        while (m_rings->commands.pop(&command)) {
+            switch (command.type) {
+            case QWebSocketThreadedCommand::Close:
+                close(command.closeCode, command.text);
+                break;
+            case QWebSocketThreadedCommand::Open:
+                open(command.url);
+                break;
+            case QWebSocketThreadedCommand::SendText:
+            case QWebSocketThreadedCommand::SendUtf8Text:
+            case QWebSocketThreadedCommand::SendBinary:
+            case QWebSocketThreadedCommand::SendBuffer:
+                send(command);
+                break;
+            case QWebSocketThreadedCommand::SendChannelText:
+                sendChannelTextMessage(command.channel, command.text);
+                break;
+            case QWebSocketThreadedCommand::SendChannelBinary:
+                sendChannelBinaryMessage(command.channel, command.data);
+                break;
+            case QWebSocketThreadedCommand::SendEncoded:
+                sendEncodedMessage(command.value, command.messageId, command.priority);
+                break;
+            }
+        }
+    } while (!m_rings->commands.sleep());
+}
+
+void QWebSocketThreadedWorker::onConnected()
+{
+    if (m_hasConnected) {
+        m_counters->reconnects.fetchAndAddRelaxed(1);
+    }
+    m_hasConnected = true;
+    m_reconnectAttempt = 0;
+    if (m_pingTimer->interval() > 0) {
+        m_pingTimer->start();
+    }
+    Q_EMIT connected();
+
+    // Already held once when coalescing
+    // Still in bufferedAmount, write() accounts for them as usual
+    const QVector<QWebSocketThreadedCommand> replay = m_replay;
+    m_replay.clear();
+    m_replayBytes = 0;
+    for (const QWebSocketThreadedCommand &command : replay) {
+        sendNow(command);
+    }
+}
+
+void QWebSocketThreadedWorker::onStateChanged(QAbstractSocket::SocketState state)
+{
+    // Published before the signal, so that state() is already right in its
+    // handlers
+    m_info.state = state;
+    if (state == QAbstractSocket::ConnectedState) {
+        m_info.peerAddress = m_webSocket->peerAddress();
+        m_info.peerPort = m_webSocket->peerPort();
+    } else if (state == QAbstractSocket::UnconnectedState) {
+        m_info.closeCode = m_webSocket->closeCode();
+        m_info.closeReason = m_webSocket->closeReason();
+        m_info.peerAddress.clear();
+        m_info.peerPort = 0;
+        m_pingTimer->stop();
+        m_pongTimer->stop();
+        m_pingSentAt = -1;
+        m_smoothedRoundTripTime = -1;
+        m_roundTripTimeVariation = -1;
+        m_info.roundTripTime = -1;
+        m_info.roundTripTimeVariation = -1;
+    }
+    publish();
+    if (state == QAbstractSocket::UnconnectedState) {
+        // The socket dropped what it didn't write, messages still waiting
+        // for the send window go with them unless they are replayed. Only
+        // that leaves bufferedAmount, the messages kept for replay stay.
+        qint64 dropped = m_bytesInFlight;
+        m_bytesInFlight = 0;
+        m_bytesHandedOver = 0;
+        m_bytesWrittenOut = 0;
+        m_pendingSent.clear();
+        QVector<QWebSocketThreadedCommand> replay;
+        for (QVector<QWebSocketThreadedCommand> &outgoing : m_outgoing) {
+            replay += outgoing;
+            outgoing.clear();
+        }
+        if (isReconnecting() && m_replayMessages) {
+            keepForReplay(replay, true);
+        } else {
+            for (const QWebSocketThreadedCommand &command : qAsConst(replay)) {
+                dropped += payloadSize(command);
+            }
+        }
+        if (dropped > 0) {
+            Q_EMIT bufferedAmountAdjusted(-dropped);
+        }
+    }
+    Q_EMIT stateChanged(state);
+    // Failed attempts don't emit disconnected(), so this is the place to
+    // schedule the next one
+    if (state != QAbstractSocket::UnconnectedState || !m_autoReconnect || m_closeRequested
+            || !m_url.isValid() || m_reconnectTimer->isActive()) {
+        return;
+    }
+    // Exponential backoff, randomly shortened by up to the jitter fraction so
+    // that clients dropped together don't come back together
+    const int shift = qMin(m_reconnectAttempt, 20);
+    const qint64 backoff = qMin<qint64>(m_maxBackoff, qint64(m_minBackoff) << shift);
+    const double factor = 1.0 - m_jitter * QRandomGenerator::global()->generateDouble();
+    ++m_reconnectAttempt;
+    m_reconnectTimer->start(int(backoff * factor));
+}
+
+void QWebSocketThreadedWorker::onError(QAbstractSocket::SocketError error)
+{
+    m_info.error = error;
+    m_info.errorString = m_webSocket->errorString();
+    publish();
+    Q_EMIT this->error(error);
+}
+
+void QWebSocketThreadedWorker::publish()
+{
+    if (m_snapshot->publish(m_info)) {
+        Q_EMIT connectionInfoChanged();
+    }
+}
+
+void QWebSocketThreadedWorker::onShutdownTimeout()
+{
+    m_webSocket->abort();
+    deleteLater();
+}
+
+void QWebSocketThreadedWorker::onCoalesceTimeout()
+{
+    writeCoalesced();
+}
+
+void QWebSocketThreadedWorker::onReconnectTimeout()
+{
+    // open() may have started another connection meanwhile
+    if (!m_closeRequested && m_webSocket->state() == QAbstractSocket::UnconnectedState) {
+        connectToServer();
+    }
+}
+
+qint64 QWebSocketThreadedWorker::nextReceivedAt()
+{
+    // Strictly increasing, so that it identifies the message in traces
+    m_lastReceivedAt = qMax(m_counters->now(), m_lastReceivedAt + 1);
+    return m_lastReceivedAt;
+}
+
+// Compressed messages only inflate whole, and the acceptance has to be seen
+// as a message, so frames aren't streamed while compression is offered or on
+bool QWebSocketThreadedWorker::streamsFrames() const
+{
+    return m_streamFrames && !m_compressionPending && !m_compressionActive;
+}
+
+bool QWebSocketThreadedWorker::isReconnecting() const
+{
+    return m_autoReconnect && !m_closeRequested && m_url.isValid()
+            && m_webSocket->state() != QAbstractSocket::ConnectedState;
+}
+
+void QWebSocketThreadedWorker::keepForReplay(const QVector<QWebSocketThreadedCommand> &commands,
+                                             bool prepend)
+{
+    for (const QWebSocketThreadedCommand &command : commands) {
+        m_replayBytes += payloadSize(command);
+    }
+    m_replay = prepend ? commands + m_replay : m_replay + commands;
+    // The oldest go first, like a lost connection would have dropped them
+    int dropped = 0;
+    qint64 droppedBytes = 0;
+    while (dropped < m_replay.size()
+           && (m_replay.size() - dropped > MaxReplayMessages || m_replayBytes - droppedBytes > MaxReplayBytes)) {
+        droppedBytes += payloadSize(m_replay.at(dropped++));
+    }
+    if (dropped == 0) {
+        return;
+    }
+    qWarning("QWebSocketThreaded: dropped %d messages kept for replay, over %d messages or %d bytes",
+             dropped, int(MaxReplayMessages), int(MaxReplayBytes));
+    m_replay.remove(0, dropped);
+    m_replayBytes -= droppedBytes;
+    Q_EMIT bufferedAmountAdjusted(-droppedBytes);
+}
+
+void QWebSocketThreadedWorker::clearReplay()
+{
+    // Never sent, like messages dropped without a connection
+    if (m_replayBytes > 0) {
+        Q_EMIT bufferedAmountAdjusted(-m_replayBytes);
+    }
+    m_replay.clear();
+    m_replayBytes = 0;
+}
+
+void QWebSocketThreadedWorker::onBytesWritten(qint64 bytes)
+{
+    Q_TRACE(QWebSocketThreaded_bytesWritten, m_counters.data(), bytes);
+    m_counters->written(bytes);
+    // Same unit as write() adds, but this also counts the pongs and close
+    // frames QWebSocket writes on its own, which were never added. Capped at
+    // what was handed over, so that they can only get the current messages
+    // reported a little early, and don't add up over the connection.
+    m_bytesInFlight = qMax<qint64>(0, m_bytesInFlight - bytes);
+    m_bytesWrittenOut = qMin(m_bytesWrittenOut + bytes, m_bytesHandedOver);
+    int sent = 0;
+    while (sent < m_pendingSent.size() && m_pendingSent.at(sent).writtenAt <= m_bytesWrittenOut) {
+        const PendingSent &pending = m_pendingSent.at(sent++);
+        Q_EMIT messageSent(pending.messageId, pending.bytes);
+    }
+    m_pendingSent.remove(0, sent);
+    writeOutgoing();
+    Q_EMIT bytesWritten(bytes);
+}
+
+void QWebSocketThreadedWorker::onTextFrameReceived(const QString &frame, bool isLastFrame)
+{
+    // The frames are counted even when only whole messages are delivered
+    const qint64 receivedAt = nextReceivedAt();
+    // QWebSocket decoded the frame, it was UTF-8 on the wire
+    m_counters->received(receivedFrameSize(qWebSocketThreadedUtf8Size(frame)), isLastFrame);
+    if (!streamsFrames()) {
+        return;
+    }
+    Q_TRACE(QWebSocketThreaded_received, m_counters.data(), receivedAt, frame.size());
+    QWebSocketThreadedMessage message;
+    message.receivedAt = receivedAt;
+    message.type = QWebSocketThreadedMessage::TextFrame;
+    message.text = frame;
+    message.isLastFrame = isLastFrame;
+    deliver(message);
+}
+
+void QWebSocketThreadedWorker::onBinaryFrameReceived(const QByteArray &frame, bool isLastFrame)
+{
+    const qint64 receivedAt = nextReceivedAt();
+    m_counters->received(receivedFrameSize(frame.size()), isLastFrame);
+    if (!streamsFrames()) {
+        return;
+    }
+    Q_TRACE(QWebSocketThreaded_received, m_counters.data(), receivedAt, frame.size());
+    QWebSocketThreadedMessage message;
+    message.receivedAt = receivedAt;
+    message.type = QWebSocketThreadedMessage::BinaryFrame;
+    message.data = frame;
+    message.isLastFrame = isLastFrame;
+    deliver(message);
+}
+
+void QWebSocketThreadedWorker::onTextMessageReceived(const QString &text)
+{
+    // With streaming the frames were already forwarded, the assembled message
+    // never leaves the network thread
+    if (streamsFrames()) {
+        return;
+    }
+    if (m_compressionPending) {
+        // Anything but the acceptance declines the offer
+        declineCompression();
+    }
+    const qint64 receivedAt = nextReceivedAt();
+    Q_TRACE(QWebSocketThreaded_received, m_counters.data(), receivedAt, text.size());
+    receiveText(text, receivedAt);
+}
+
+void QWebSocketThreadedWorker::onBinaryMessageReceived(const QByteArray &data)
+{
+    if (streamsFrames()) {
+        return;
+    }
+    if (m_compressionPending) {
+        if (data == compressionAccepted()) {
+            acceptCompression();
+            return;
+        }
+        declineCompression();
+    }
+    const qint64 receivedAt = nextReceivedAt();
+    Q_TRACE(QWebSocketThreaded_received, m_counters.data(), receivedAt, data.size());
+    const char header = data.isEmpty() ? '\0' : data.at(0);
+    if (m_compressionActive && (header == CompressedText || header == CompressedBinary)) {
+        QByteArray decompressed;
+        switch (m_deflate->decompress(data.mid(1), maxDecompressedSize(), &decompressed)) {
+        case QWebSocketThreadedDeflate::Ok:
+            break;
+        case QWebSocketThreadedDeflate::Failed:
+            // Same as a permessage-deflate endpoint would do
+            m_webSocket->close(QWebSocketProtocol::CloseCodeWrongDatatype,
+                               QStringLiteral("Invalid compressed message"));
+            return;
+        case QWebSocketThreadedDeflate::TooLarge:
+            m_webSocket->close(QWebSocketProtocol::CloseCodeTooMuchData,
+                               QStringLiteral("Decompressed message too large"));
+            return;
+        }
+        if (header == CompressedText) {
+            receiveUtf8Text(decompressed, receivedAt);
+            return;
+        }
+        receiveBinary(decompressed, receivedAt);
+        return;
+    }
+    receiveBinary(data, receivedAt);
+}
+
+bool QWebSocketThreadedWorker::compress(char header, const QByteArray &data, QByteArray *payload)
+{
+    QByteArray compressed;
+    if (!m_deflate->compress(data, &compressed)) {
+        // The server's inflate context can't follow anymore
+        m_webSocket->close(QWebSocketProtocol::CloseCodeBadOperation,
+                           QStringLiteral("Compression failed"));
+        return false;
+    }
+    *payload = header + compressed;
+    return true;
+}
+
+void QWebSocketThreadedWorker::acceptCompression()
+{
+    m_compressionPending = false;
+    m_compressionActive = true;
+    // Everything sent after the echo is compressed, the server knows that
+    // whatever came before it is plain
+    const qint64 wire = wireSize(m_webSocket->sendBinaryMessage(compressionAccepted()));
+    m_bytesInFlight += wire;
+    m_bytesHandedOver += wire;
+    // Not from the GUI thread, which still sees it written
+    Q_EMIT bufferedAmountAdjusted(wire);
+}
+
+void QWebSocketThreadedWorker::declineCompression()
+{
+    m_compressionPending = false;
+    m_deflate.reset();
+}
+
+qint64 QWebSocketThreadedWorker::wireSize(qint64 payload) const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    const qint64 frameSize = qMax<qint64>(1, m_webSocket->outgoingFrameSize());
+#else
+    // FRAME_SIZE_IN_BYTES, QWebSocket splits larger messages into frames
+    const qint64 frameSize = 512 * 512 * 2;
+#endif
+    qint64 size = 0;
+    qint64 left = payload;
+    do {
+        const qint64 frame = qMin(left, frameSize);
+        // Header, extended length, and the mask of a client frame
+        size += 2 + (frame > 0xffff ? 8 : frame > 125 ? 2 : 0) + 4 + frame;
+        left -= frame;
+    } while (left > 0);
+    return size;
+}
+
+int QWebSocketThreadedWorker::maxDecompressedSize() const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    return int(qMin<quint64>(MaxDecompressedSize, m_webSocket->maxAllowedIncomingMessageSize()));
+#else
+    return MaxDecompressedSize;
+#endif
+}
+
+void QWebSocketThreadedWorker::receiveText(const QString &text, qint64 receivedAt)
+{
+    QWebSocketThreadedMessage message;
+    message.isLastFrame = true;
+    message.receivedAt = receivedAt;
+    if (m_multiplexed) {
+        // "channel:payload", anything else doesn't belong to any channel
+        const int separator = text.indexOf(QLatin1Char(':'));
+        if (separator < 0) {
+            return;
+        }
+        message.channel = text.left(separator);
+        // Nobody joined it, not worth a trip to the GUI thread
+        if (!m_channels.isEmpty() && !m_channels.contains(message.channel)) {
+            return;
+        }
+        message.type = QWebSocketThreadedMessage::ChannelText;
+        message.text = text.mid(separator + 1);
+        // Channel messages keep their channel, a route is ignored
+        if (filterText(message.text, Q_NULLPTR, Q_NULLPTR)) {
+            deliver(message);
+        }
+        return;
+    }
+    // Parsed at most once, for the filter, the key and parseJson
+    QJsonParseError parseError;
+    QJsonDocument document;
+    bool parsed = false;
+    const auto parse = [&]() {
+        if (!parsed) {
+            document = QJsonDocument::fromJson(text.toUtf8(), &parseError);
+            parsed = true;
+        }
+    };
+    if (m_filter && m_filter->wantsJson()) {
+        parse();
+    }
+    QString route;
+    if (!filterText(text, parsed ? &document : Q_NULLPTR, &route)) {
+        return;
+    }
+    if (!route.isEmpty()) {
+        message.type = QWebSocketThreadedMessage::ChannelText;
+        message.channel = route;
+        message.text = text;
+        deliver(message);
+        return;
+    }
+    if (m_processor) {
+        QVariantList output;
+        m_processor->processTextMessage(text, &output);
+        deliverProcessed(output, receivedAt);
+        return;
+    }
+    QString key;
+    if (m_keyExtractor && m_keyExtractor->wantsJson()) {
+        parse();
+        key = m_keyExtractor->jsonMessageKey(text, document);
+    } else if (m_keyExtractor) {
+        key = m_keyExtractor->textMessageKey(text);
+    }
+    if (m_parseJson) {
+        // Messages that are not valid JSON are still delivered as text
+        parse();
+        if (parseError.error == QJsonParseError::NoError) {
+            message.type = QWebSocketThreadedMessage::Json;
+            message.value = document.toVariant();
+            deliver(key, message);
+            return;
+        }
+    }
+    if (m_utf8Text) {
+        message.type = QWebSocketThreadedMessage::Utf8Text;
+        message.data = text.toUtf8();
+        deliver(key, message);
+        return;
+    }
+    message.type = QWebSocketThreadedMessage::Text;
+    message.text = text;
+    deliver(key, message);
+}
+
+void QWebSocketThreadedWorker::receiveUtf8Text(const QByteArray &text, qint64 receivedAt)
+{
+    // Channels, filters, keys, processors and JSON all work on QString
+    if (!m_utf8Text || m_multiplexed || m_filter || m_keyExtractor || m_processor || m_parseJson) {
+        receiveText(QString::fromUtf8(text), receivedAt);
+        return;
+    }
+    if (!isValidUtf8(text)) {
+        // Same as QWebSocket does with an uncompressed text message
+        m_webSocket->close(QWebSocketProtocol::CloseCodeWrongDatatype,
+                           QStringLiteral("Invalid UTF-8 code encountered"));
+        return;
+    }
+    QWebSocketThreadedMessage message;
+    message.type = QWebSocketThreadedMessage::Utf8Text;
+    message.data = text;
+    message.isLastFrame = true;
+    message.receivedAt = receivedAt;
+    deliver(message);
+}
+
+void QWebSocketThreadedWorker::receiveBinary(const QByteArray &data, qint64 receivedAt)
+{
+    QWebSocketThreadedMessage message;
+    message.isLastFrame = true;
+    message.receivedAt = receivedAt;
+    if (m_multiplexed) {
+        // One byte with the length of the UTF-8 channel id, the id, the payload
+        const int length = data.isEmpty() ? -1 : int(uchar(data.at(0)));
+        if (length < 0 || data.size() < 1 + length) {
+            return;
+        }
+        message.channel = QString::fromUtf8(data.constData() + 1, length);
+        if (!m_channels.isEmpty() && !m_channels.contains(message.channel)) {
+            return;
+        }
+        message.type = QWebSocketThreadedMessage::ChannelBinary;
+        message.data = data.mid(1 + length);
+        if (filterBinary(message.data, Q_NULLPTR)) {
+            deliver(message);
+        }
+        return;
+    }
+    QString route;
+    if (!filterBinary(data, &route)) {
+        return;
+    }
+    message.data = data;
+    if (!route.isEmpty()) {
+        message.type = QWebSocketThreadedMessage::ChannelBinary;
+        message.channel = route;
+        deliver(message);
+        return;
+    }
+    if (m_processor) {
+        QVariantList output;
+        m_processor->processBinaryMessage(data, &output);
+        deliverProcessed(output, receivedAt);
+        return;
+    }
+    if (m_binaryFormat != QWebSocketThreadedCodec::Raw
+            && QWebSocketThreadedCodec::decode(m_binaryFormat, data, &message.value)) {
+        message.type = QWebSocketThreadedMessage::Decoded;
+        message.data.clear();
+        deliver(m_keyExtractor ? m_keyExtractor->binaryMessageKey(data) : QString(), message);
+        return;
+    }
+    message.value.clear();
+    message.type = QWebSocketThreadedMessage::Binary;
+    deliver(m_keyExtractor ? m_keyExtractor->binaryMessageKey(data) : QString(), message);
+}
+
+bool QWebSocketThreadedWorker::filterText(const QString &text, const QJsonDocument *document,
+                                          QString *route)
+{
+    QString ignored;
+    if (!m_filter) {
+        return true;
+    }
+    const bool accepted = document
+            ? m_filter->filterJsonMessage(text, *document, route ? route : &ignored)
+            : m_filter->filterTextMessage(text, route ? route : &ignored);
+    if (accepted) {
+        return true;
+    }
+    m_counters->filtered();
+    return false;
+}
+
+bool QWebSocketThreadedWorker::filterBinary(const QByteArray &data, QString *route)
+{
+    QString ignored;
+    if (!m_filter || m_filter->filterBinaryMessage(data, route ? route : &ignored)) {
+        return true;
+    }
+    m_counters->filtered();
+    return false;
+}
+
+void QWebSocketThreadedWorker::deliver(const QString &key, const QWebSocketThreadedMessage &message)
+{
+    if (key.isNull()) {
+        deliver(message);
+        return;
+    }
+    // Always through the queue, whatever the transport: it is the map of the
+    // latest message per key, so only the keys that changed since the last
+    // drain reach the GUI thread.
+    Q_TRACE(QWebSocketThreaded_enqueued, m_counters.data(), message.receivedAt, int(message.type));
+    m_counters->queued();
+    bool replaced;
+    if (m_queue->enqueue(key, message, &replaced)) {
+        Q_EMIT messagesQueued();
+    }
+    if (replaced) {
+        m_counters->conflated();
+    }
+}
+
+void QWebSocketThreadedWorker::deliverProcessed(const QVariantList &output, qint64 receivedAt)
+{
+    if (output.isEmpty()) {
+        m_counters->filtered();
+        return;
+    }
+    QWebSocketThreadedMessage message;
+    message.type = QWebSocketThreadedMessage::Processed;
+    message.isLastFrame = true;
+    message.receivedAt = receivedAt;
+    for (const QVariant &value : output) {
+        message.value = value;
+        deliver(message);
+    }
+}
+
+void QWebSocketThreadedWorker::deliver(const QWebSocketThreadedMessage &message)
+{
+    Q_TRACE(QWebSocketThreaded_enqueued, m_counters.data(), message.receivedAt, int(message.type));
+    m_counters->queued();
+    if (m_paced) {
+        // The GUI thread drains the queue at its own pace, it is only told
+        // when there is something new
+        if (m_queue->enqueue(message)) {
+            Q_EMIT messagesQueued();
+        }
+        return;
+    }
+    if (m_ringTransport) {
+        if (m_rings->messages.push(message)) {
+            Q_EMIT messagesPushed();
+        }
+        return;
+    }
+    if (m_batchMessages && !message.isFrame() && !message.isChannel()) {
+        // Only the first message after a drain posts an event to the GUI
+        // thread, everything arriving before the drain runs rides along with it.
+        if (m_queue->enqueue(message)) {
+            Q_EMIT messagesQueued();
+        }
+        return;
+    }
+    switch (message.type) {
+    case QWebSocketThreadedMessage::Text:
+        Q_EMIT textMessageReceived(message.text, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::Binary:
+        Q_EMIT binaryMessageReceived(message.data, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::Json:
+        Q_EMIT jsonMessageReceived(message.value, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::TextFrame:
+        Q_EMIT textFrameReceived(message.text, message.isLastFrame, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::BinaryFrame:
+        Q_EMIT binaryFrameReceived(message.data, message.isLastFrame, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::ChannelText:
+        Q_EMIT channelTextMessageReceived(message.channel, message.text, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::ChannelBinary:
+        Q_EMIT channelBinaryMessageReceived(message.channel, message.data, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::Utf8Text:
+        Q_EMIT utf8TextMessageReceived(message.data, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::Processed:
+        Q_EMIT processedMessageReceived(message.value, message.receivedAt);
+        break;
+    case QWebSocketThreadedMessage::Decoded:
+        Q_EMIT decodedMessageReceived(message.value, message.receivedAt);
+        break;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,500 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADED_P_H
+#define QWEBSOCKETTHREADED_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVariant>
+#include <QVector>
+#include <QtWebSockets/QWebSocket>
+#include "qwebsocketthreaded.h"
+#include "qwebsocketthreadedbufferpool.h"
+#include "qwebsocketthreadedfilter.h"
+#include "qwebsocketthreadedring_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+class QWebSocketThreadedDeflate;
+
+struct QWebSocketThreadedMessage
+{
+    enum Type
+    {
+        Text,
+        Binary,
+        Json,
+        TextFrame,
+        BinaryFrame,
+        ChannelText,
+        ChannelBinary,
+        // UTF-8 in data
+        Utf8Text,
+        // Output of the processor in value
+        Processed,
+        // Decoded with the binary format in value
+        Decoded
+    };
+
+    Type type;
+    QString channel;
+    QString text;
+    QByteArray data;
+    QVariant value;
+    bool isLastFrame;
+    // QWebSocketThreadedCounters::now() when the worker got it
+    qint64 receivedAt;
+
+    bool isFrame() const { return type == TextFrame || type == BinaryFrame; }
+    bool isChannel() const { return type == ChannelText || type == ChannelBinary; }
+};
+Q_DECLARE_TYPEINFO(QWebSocketThreadedMessage, Q_MOVABLE_TYPE);
+
+// Size of the text once encoded as UTF-8, as it goes on the wire, without
+// encoding it. Lone surrogates count as the replacement character.
+qint64 qWebSocketThreadedUtf8Size(const QString &text);
+
+struct QWebSocketThreadedCommand
+{
+    enum Type
+    {
+        Close,
+        Open,
+        SendText,
+        SendUtf8Text,
+        SendBinary,
+        SendBuffer,
+        SendChannelText,
+        SendChannelBinary,
+        // Encoded with the binary format of the worker, becomes SendBinary
+        SendEncoded
+    };
+
+    Type type;
+    QWebSocketProtocol::CloseCode closeCode;
+    QUrl url;
+    QString channel;
+    QString text;
+    QByteArray data;
+    QWebSocketThreadedBuffer buffer;
+    QVariant value;
+    qint64 messageId;
+    // QWebSocketThreaded::Priority of the messages to send
+    int priority;
+};
+Q_DECLARE_TYPEINFO(QWebSocketThreadedCommand, Q_MOVABLE_TYPE);
+
+// Used instead of queued signals with QWebSocketThreaded::RingTransport
+struct QWebSocketThreadedRings
+{
+    QWebSocketThreadedRing<QWebSocketThreadedCommand> commands;
+    QWebSocketThreadedRing<QWebSocketThreadedMessage> messages;
+};
+
+// Cheap enough to be always on: updated without locking, mostly by the
+// worker, and read from any thread by QWebSocketThreadedStats.
+struct QWebSocketThreadedCounters
+{
+    // Power of two buckets in microseconds, the last one takes everything
+    // above 2^22 us
+    enum { LatencyBuckets = 24 };
+
+    QWebSocketThreadedCounters() { m_clock.start(); }
+
+    qint64 now() const { return m_clock.nsecsElapsed(); }
+
+    // Worker side
+    // Bytes on the wire both ways, frame headers included, see
+    // QWebSocketThreadedStats
+    void received(qint64 bytes, bool isLastFrame);
+    void sent();
+    void written(qint64 bytes) { bytesOut.fetchAndAddRelaxed(bytes); }
+    void filtered();
+    // A queued message was replaced by a newer one with the same key
+    void conflated();
+    void queued();
+
+    // GUI side, for every message handed over by the worker
+    void dispatched(qint64 receivedAt);
+
+    QAtomicInteger<qint64> messagesIn;
+    QAtomicInteger<qint64> bytesIn;
+    QAtomicInteger<qint64> messagesOut;
+    QAtomicInteger<qint64> bytesOut;
+    QAtomicInteger<qint64> messagesFiltered;
+    QAtomicInteger<qint64> messagesConflated;
+    QAtomicInt queueDepth;
+    QAtomicInt maxQueueDepth;
+    QAtomicInt reconnects;
+    QAtomicInt dispatchLatency[LatencyBuckets];
+
+private:
+    QElapsedTimer m_clock;
+};
+
+// Published by the worker, read from any thread. The state and the error
+// code are atomics so that their accessors never lock, the rest is copied
+// under a mutex held only for the copy.
+class QWebSocketThreadedSnapshot
+{
+    Q_DISABLE_COPY(QWebSocketThreadedSnapshot)
+
+public:
+    QWebSocketThreadedSnapshot();
+
+    QAbstractSocket::SocketState state() const;
+    QAbstractSocket::SocketError error() const;
+    QWebSocketThreadedConnectionInfo info() const;
+
+    // Returns true if the reader has to be notified, false if the previous
+    // notification wasn't handled yet
+    bool publish(const QWebSocketThreadedConnectionInfo &info);
+    // Called by the reader when notified, before reading
+    void notified();
+
+private:
+    mutable QMutex m_mutex;
+    QWebSocketThreadedConnectionInfo m_info;
+    QAtomicInt m_state;
+    QAtomicInt m_error;
+    QAtomicInt m_notifyPending;
+};
+
+// Messages received by the worker while batching is enabled, drained by the
+// GUI thread in one go.
+class QWebSocketThreadedQueue
+{
+    Q_DISABLE_COPY(QWebSocketThreadedQueue)
+
+public:
+    QWebSocketThreadedQueue() {}
+
+    // Returns true if the queue was empty, the consumer has to be woken up then
+    bool enqueue(const QWebSocketThreadedMessage &message);
+    // Replaces the message queued with the same key since the last drain, if
+    // any, in place. The queue holds at most one message per key then.
+    bool enqueue(const QString &key, const QWebSocketThreadedMessage &message, bool *replaced);
+    QVector<QWebSocketThreadedMessage> takeAll();
+
+private:
+    QMutex m_mutex;
+    QVector<QWebSocketThreadedMessage> m_messages;
+    // Index in m_messages
+    QHash<QString, int> m_keys;
+};
+
+// Lives in the network thread and owns the actual QWebSocket.
+class QWebSocketThreadedWorker : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QWebSocketThreadedWorker)
+
+public:
+    QWebSocketThreadedWorker(const QString &origin,
+                             QWebSocketProtocol::Version version,
+                             const QSharedPointer<QWebSocketThreadedQueue> &queue,
+                             const QSharedPointer<QWebSocketThreadedCounters> &counters,
+                             const QSharedPointer<QWebSocketThreadedSnapshot> &snapshot);
+    ~QWebSocketThreadedWorker();
+
+    // Same values as QWebSocketThreaded::Priority
+    enum
+    {
+        HighPriority,
+        NormalPriority,
+        LowPriority,
+        PriorityCount
+    };
+
+public Q_SLOTS:
+    void close(QWebSocketProtocol::CloseCode closeCode, const QString &reason);
+    void open(const QUrl &url);
+    // The owner is gone: closes the connection, within ShutdownTimeout ms,
+    // and deletes itself
+    void shutdown();
+    // The pool stops its threads: no more waiting for the close handshake
+    void abortShutdown();
+    // A positive messageId is reported back with messageSent() once written,
+    // negative ones only identify the message in traces
+    void sendTextMessage(const QString &message, qint64 messageId, int priority);
+    void sendUtf8TextMessage(const QByteArray &message, qint64 messageId, int priority);
+    void sendBinaryMessage(const QByteArray &data, qint64 messageId, int priority);
+    // The buffer goes back to its pool once written
+    void sendBinaryBuffer(const QWebSocketThreadedBuffer &buffer, qint64 messageId, int priority);
+    void sendEncodedMessage(const QVariant &message, qint64 messageId, int priority);
+    void sendChannelTextMessage(const QString &channel, const QString &message);
+    void sendChannelBinaryMessage(const QString &channel, const QByteArray &data);
+    void setBatchMessages(bool batchMessages);
+    void setParseJson(bool parseJson);
+    void setStreamFrames(bool streamFrames);
+    void setMultiplexed(bool multiplexed);
+    void setChannels(const QStringList &channels);
+    // Applied to whole messages only, frames streamed with streamFrames are
+    // never filtered
+    void setFilter(const QSharedPointer<QWebSocketThreadedFilter> &filter);
+    // Messages with a key are conflated, see QWebSocketThreaded::setKeyExtractor()
+    void setKeyExtractor(const QSharedPointer<QWebSocketThreadedKeyExtractor> &keyExtractor);
+    void setProcessor(const QSharedPointer<QWebSocketThreadedProcessor> &processor);
+    // Every message goes through the queue, see QWebSocketThreaded::setPaced()
+    void setPaced(bool paced);
+    // Plain text messages are delivered as UTF-8 with utf8TextMessageReceived()
+    void setUtf8Text(bool utf8Text);
+    // QWebSocketThreaded::BinaryFormat of the received and encoded messages
+    void setBinaryFormat(int binaryFormat);
+    // Messages are only handed to the socket while fewer than sendWindow
+    // bytes are waiting to be written, the others wait in per-priority
+    // queues. 0 hands them over right away.
+    void setSendWindow(qint64 sendWindow);
+    // With coalesce, Send commands are held until the end of the event loop
+    // turn, or for up to delay ms, and then handed to the socket together
+    // and flushed with one write. Disabling it writes the held ones.
+    void setCoalescing(bool coalesce, int delay);
+    // While reconnecting, messages are dropped or kept for the next
+    // connection depending on replayMessages
+    void setReconnectPolicy(bool autoReconnect, int minBackoff, int maxBackoff, double jitter,
+                            bool replayMessages);
+    // Takes effect with the next open()
+    void setCompression(bool compression, int windowBits, bool contextTakeover);
+    // Pings every pingInterval ms while connected, 0 disables it. Without a
+    // pong within pongTimeout ms, 0 for no limit, the connection is aborted
+    // and the reconnect policy applies.
+    void setKeepalive(int pingInterval, int pongTimeout);
+    void ping(const QByteArray &payload);
+    // A null pointer switches back to queued signals
+    void setRingTransport(const QSharedPointer<QWebSocketThreadedRings> &rings);
+    void processCommands();
+
+Q_SIGNALS:
+    void connected();
+    void disconnected();
+    void stateChanged(QAbstractSocket::SocketState state);
+    void textFrameReceived(const QString &frame, bool isLastFrame, qint64 receivedAt);
+    void binaryFrameReceived(const QByteArray &frame, bool isLastFrame, qint64 receivedAt);
+    void textMessageReceived(const QString &message, qint64 receivedAt);
+    void utf8TextMessageReceived(const QByteArray &message, qint64 receivedAt);
+    void binaryMessageReceived(const QByteArray &message, qint64 receivedAt);
+    void jsonMessageReceived(const QVariant &message, qint64 receivedAt);
+    void processedMessageReceived(const QVariant &message, qint64 receivedAt);
+    void decodedMessageReceived(const QVariant &message, qint64 receivedAt);
+    void channelTextMessageReceived(const QString &channel, const QString &message, qint64 receivedAt);
+    void channelBinaryMessageReceived(const QString &channel, const QByteArray &message, qint64 receivedAt);
+    void error(QAbstractSocket::SocketError error);
+    void pong(quint64 elapsedTime, const QByteArray &payload);
+    void bytesWritten(qint64 bytes);
+    void messageSent(qint64 messageId, qint64 bytes);
+    // The payload on the wire differs from what the GUI thread accounted for
+    void bufferedAmountAdjusted(qint64 delta);
+    void messagesQueued();
+    void messagesPushed();
+    void connectionInfoChanged();
+
+private Q_SLOTS:
+    void onConnected();
+    void onStateChanged(QAbstractSocket::SocketState state);
+    void onError(QAbstractSocket::SocketError error);
+    void onReconnectTimeout();
+    void onShutdownTimeout();
+    void onCoalesceTimeout();
+    void onPingTimeout();
+    void onPongTimeout();
+    void onPong(quint64 elapsedTime, const QByteArray &payload);
+    void onBytesWritten(qint64 bytes);
+    void onTextFrameReceived(const QString &frame, bool isLastFrame);
+    void onBinaryFrameReceived(const QByteArray &frame, bool isLastFrame);
+    void onTextMessageReceived(const QString &text);
+    void onBinaryMessageReceived(const QByteArray &data);
+
+private:
+    // First byte of a compressed message, sent as a binary frame
+    enum
+    {
+        CompressedText = 0x01,
+        CompressedBinary = 0x02
+    };
+    enum
+    {
+        ShutdownTimeout = 5000,
+        // QWebSocket itself takes messages up to 2 GB
+        MaxDecompressedSize = 64 * 1024 * 1024,
+        // Messages kept for replayMessages, the oldest go beyond either
+        MaxReplayMessages = 65536,
+        MaxReplayBytes = 16 * 1024 * 1024
+    };
+    // A posted message waiting to be written, reported with messageSent()
+    // once bytesWritten() got past its last byte
+    struct PendingSent
+    {
+        qint64 messageId;
+        qint64 bytes;
+        qint64 writtenAt;
+    };
+
+    QWebSocket *m_webSocket;
+    QSharedPointer<QWebSocketThreadedQueue> m_queue;
+    QSharedPointer<QWebSocketThreadedCounters> m_counters;
+    QSharedPointer<QWebSocketThreadedSnapshot> m_snapshot;
+    // What was last published to m_snapshot
+    QWebSocketThreadedConnectionInfo m_info;
+    bool m_hasConnected;
+    bool m_batchMessages;
+    bool m_parseJson;
+    bool m_streamFrames;
+    bool m_multiplexed;
+    // Empty routes every channel
+    QSet<QString> m_channels;
+    bool m_paced;
+    bool m_utf8Text;
+    int m_binaryFormat;
+    qint64 m_sendWindow;
+    // Handed to the socket and not yet written, frame headers included like
+    // bytesWritten() counts them
+    qint64 m_bytesInFlight;
+    // Handed to the socket and written since connecting, in the same unit
+    qint64 m_bytesHandedOver;
+    qint64 m_bytesWrittenOut;
+    QVector<PendingSent> m_pendingSent;
+    QVector<QWebSocketThreadedCommand> m_outgoing[PriorityCount];
+    bool m_coalesceSends;
+    // Send commands held by coalescing, in order
+    QVector<QWebSocketThreadedCommand> m_coalesced;
+    QTimer *m_coalesceTimer;
+    QSharedPointer<QWebSocketThreadedFilter> m_filter;
+    QSharedPointer<QWebSocketThreadedKeyExtractor> m_keyExtractor;
+    QSharedPointer<QWebSocketThreadedProcessor> m_processor;
+    bool m_compression;
+    int m_compressionWindowBits;
+    bool m_compressionContextTakeover;
+    // Set while the offer is made, and kept once it is accepted
+    QScopedPointer<QWebSocketThreadedDeflate> m_deflate;
+    // Offered, waiting for the first message of the server
+    bool m_compressionPending;
+    // Accepted by the server, messages are compressed both ways
+    bool m_compressionActive;
+    // Kept after switching back to signals, the ring may still hold commands
+    QSharedPointer<QWebSocketThreadedRings> m_rings;
+    bool m_ringTransport;
+
+    QTimer *m_reconnectTimer;
+    QUrl m_url;
+    bool m_closeRequested;
+    bool m_autoReconnect;
+    int m_minBackoff;
+    int m_maxBackoff;
+    double m_jitter;
+    bool m_replayMessages;
+    int m_reconnectAttempt;
+    QVector<QWebSocketThreadedCommand> m_replay;
+    qint64 m_replayBytes;
+
+    QTimer *m_pingTimer;
+    QTimer *m_pongTimer;
+    // QWebSocketThreadedCounters::now() of the keepalive ping waiting for its
+    // pong, -1 if none, and its payload
+    qint64 m_pingSentAt;
+    QByteArray m_pingPayload;
+    quint64 m_pingSequence;
+    // Smoothed like RFC 6298 does for TCP, in nanoseconds, of the
+    // current connection
+    qint64 m_smoothedRoundTripTime;
+    qint64 m_roundTripTimeVariation;
+    qint64 m_lastReceivedAt;
+
+    void connectToServer();
+    void publish();
+    // QWebSocketThreadedCounters::now() for a received message
+    qint64 nextReceivedAt();
+    bool streamsFrames() const;
+    bool isReconnecting() const;
+    // Drops the oldest beyond MaxReplayMessages or MaxReplayBytes
+    void keepForReplay(const QVector<QWebSocketThreadedCommand> &commands, bool prepend);
+    void clearReplay();
+    // Closes the connection when zlib fails
+    bool compress(char header, const QByteArray &data, QByteArray *payload);
+    // The server's first message either accepts the compression offer or
+    // declines it, see QWebSocketThreaded::setCompression()
+    void acceptCompression();
+    void declineCompression();
+    int maxDecompressedSize() const;
+    // Bytes QWebSocket writes for a message of payload bytes, frame headers
+    // and masks included
+    qint64 wireSize(qint64 payload) const;
+    // Holds a Send command with coalescing, sendNow() otherwise
+    void send(const QWebSocketThreadedCommand &command);
+    // Replays, queues or writes a Send command
+    void sendNow(const QWebSocketThreadedCommand &command);
+    // Sends the held commands and flushes the socket
+    void writeCoalesced();
+    bool hasOutgoing() const;
+    void writeOutgoing();
+    void write(const QWebSocketThreadedCommand &command);
+    void receiveText(const QString &text, qint64 receivedAt);
+    // Text that is still UTF-8, from a compressed message
+    void receiveUtf8Text(const QByteArray &text, qint64 receivedAt);
+    void receiveBinary(const QByteArray &data, qint64 receivedAt);
+    // Count the dropped messages, route may be null when routing doesn't apply
+    // With a document, the filter is given the text already parsed as JSON
+    bool filterText(const QString &text, const QJsonDocument *document, QString *route);
+    bool filterBinary(const QByteArray &data, QString *route);
+    // An empty output counts as filtered
+    void deliverProcessed(const QVariantList &output, qint64 receivedAt);
+    void deliver(const QWebSocketThreadedMessage &message);
+    void deliver(const QString &key, const QWebSocketThreadedMessage &message);
+};
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QSharedPointer<QWebSocketThreadedRings>)
+
+#endif // QWEBSOCKETTHREADED_P_H
@@ -0,0 +1,200 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadedbufferpool.h"
+
+#include <QSharedPointer>
+
+QT_BEGIN_NAMESPACE
+
+struct QWebSocketThreadedBufferBlock
+{
+    QAtomicInt ref;
+    // Never shared, so that writing doesn't detach
+    QByteArray storage;
+    QWeakPointer<QWebSocketThreadedBufferPool> pool;
+};
+
+QWebSocketThreadedBuffer::QWebSocketThreadedBuffer(QWebSocketThreadedBufferBlock *block)
+    : m_block(block)
+{
+    m_block->ref.ref();
+}
+
+QWebSocketThreadedBuffer::QWebSocketThreadedBuffer(const QWebSocketThreadedBuffer &other)
+    : m_block(other.m_block)
+{
+    if (m_block) {
+        m_block->ref.ref();
+    }
+}
+
+QWebSocketThreadedBuffer &QWebSocketThreadedBuffer::operator=(const QWebSocketThreadedBuffer &other)
+{
+    if (other.m_block) {
+        other.m_block->ref.ref();
+    }
+    if (m_block && !m_block->ref.deref()) {
+        QWebSocketThreadedBufferPool::release(m_block);
+    }
+    m_block = other.m_block;
+    return *this;
+}
+
+QWebSocketThreadedBuffer::~QWebSocketThreadedBuffer()
+{
+    if (m_block && !m_block->ref.deref()) {
+        QWebSocketThreadedBufferPool::release(m_block);
+    }
+}
+
+char *QWebSocketThreadedBuffer::data()
+{
+    return m_block ? m_block->storage.data() : Q_NULLPTR;
+}
+
+const char *QWebSocketThreadedBuffer::constData() const
+{
+    return m_block ? m_block->storage.constData() : Q_NULLPTR;
+}
+
+int QWebSocketThreadedBuffer::size() const
+{
+    return m_block ? m_block->storage.size() : 0;
+}
+
+int QWebSocketThreadedBuffer::capacity() const
+{
+    return m_block ? m_block->storage.capacity() : 0;
+}
+
+void QWebSocketThreadedBuffer::resize(int size)
+{
+    if (m_block) {
+        m_block->storage.resize(size);
+    }
+}
+
+QWebSocketThreadedBufferPool::QWebSocketThreadedBufferPool(int maxCount)
+    : m_maxCount(qMax(0, maxCount)),
+      m_allocations(0)
+{
+    // Recycling doesn't allocate either
+    m_free.reserve(m_maxCount);
+}
+
+QWebSocketThreadedBufferPool::~QWebSocketThreadedBufferPool()
+{
+    // The buffers still in use are deleted with their last copy
+    qDeleteAll(m_free);
+}
+
+QWebSocketThreadedBuffer QWebSocketThreadedBufferPool::acquire(int size)
+{
+    size = qMax(0, size);
+    QWebSocketThreadedBufferBlock *block = Q_NULLPTR;
+    {
+        QMutexLocker locker(&m_mutex);
+        // The most recently released buffer first, it is the likeliest to
+        // still be in the cache
+        for (int i = m_free.size() - 1; i >= 0; --i) {
+            if (m_free.at(i)->storage.capacity() >= size) {
+                block = m_free.at(i);
+                m_free.remove(i);
+                break;
+            }
+        }
+    }
+    if (!block) {
+        block = new QWebSocketThreadedBufferBlock;
+        // reserve() also keeps resize(0) from releasing the memory
+        block->storage.reserve(size);
+        block->pool = sharedFromThis();
+        m_allocations.fetchAndAddRelaxed(1);
+    }
+    block->storage.resize(size);
+    return QWebSocketThreadedBuffer(block);
+}
+
+int QWebSocketThreadedBufferPool::maxCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxCount;
+}
+
+void QWebSocketThreadedBufferPool::setMaxCount(int maxCount)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxCount = qMax(0, maxCount);
+    while (m_free.size() > m_maxCount) {
+        delete m_free.takeFirst();
+    }
+    m_free.reserve(m_maxCount);
+}
+
+int QWebSocketThreadedBufferPool::freeCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_free.size();
+}
+
+qint64 QWebSocketThreadedBufferPool::allocations() const
+{
+    return m_allocations.load();
+}
+
+void QWebSocketThreadedBufferPool::release(QWebSocketThreadedBufferBlock *block)
+{
+    const QSharedPointer<QWebSocketThreadedBufferPool> pool = block->pool.toStrongRef();
+    if (pool) {
+        pool->recycle(block);
+    } else {
+        delete block;
+    }
+}
+
+void QWebSocketThreadedBufferPool::recycle(QWebSocketThreadedBufferBlock *block)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_free.size() < m_maxCount) {
+        m_free.append(block);
+        return;
+    }
+    locker.unlock();
+    delete block;
+}
+
+QT_END_NAMESPACE
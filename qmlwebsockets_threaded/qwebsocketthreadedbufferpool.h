@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDBUFFERPOOL_H
+#define QWEBSOCKETTHREADEDBUFFERPOOL_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QEnableSharedFromThis>
+#include <QMetaType>
+#include <QMutex>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QWebSocketThreadedBufferPool;
+struct QWebSocketThreadedBufferBlock;
+
+// Memory for one outgoing binary message, taken from a
+// QWebSocketThreadedBufferPool. Copies share the memory, which goes back to
+// the pool when the last copy is gone, from whatever thread that happens on.
+// Copying never allocates, unlike sharing a QSharedPointer through a queue.
+class QWebSocketThreadedBuffer
+{
+public:
+    QWebSocketThreadedBuffer() : m_block(Q_NULLPTR) {}
+    QWebSocketThreadedBuffer(const QWebSocketThreadedBuffer &other);
+    QWebSocketThreadedBuffer &operator=(const QWebSocketThreadedBuffer &other);
+    ~QWebSocketThreadedBuffer();
+
+    bool isNull() const { return !m_block; }
+
+    // Must not be written after the buffer was handed to a socket
+    char *data();
+    const char *constData() const;
+    int size() const;
+    int capacity() const;
+    // Doesn't allocate up to capacity()
+    void resize(int size);
+
+private:
+    friend class QWebSocketThreadedBufferPool;
+
+    explicit QWebSocketThreadedBuffer(QWebSocketThreadedBufferBlock *block);
+
+    QWebSocketThreadedBufferBlock *m_block;
+};
+Q_DECLARE_TYPEINFO(QWebSocketThreadedBuffer, Q_MOVABLE_TYPE);
+
+// Thread-safe pool of reusable outgoing buffers, see
+// QWebSocketThreaded::bufferPool(). Has to be owned by a QSharedPointer.
+class QWebSocketThreadedBufferPool : public QEnableSharedFromThis<QWebSocketThreadedBufferPool>
+{
+    Q_DISABLE_COPY(QWebSocketThreadedBufferPool)
+
+public:
+    // Keeps at most maxCount free buffers, the others are released
+    explicit QWebSocketThreadedBufferPool(int maxCount = 64);
+    ~QWebSocketThreadedBufferPool();
+
+    // Returns a buffer of size bytes with undefined contents, reusing a free
+    // one with enough capacity if there is any
+    QWebSocketThreadedBuffer acquire(int size);
+
+    int maxCount() const;
+    void setMaxCount(int maxCount);
+    int freeCount() const;
+    // Buffers ever allocated by the pool, a growing count means that the pool
+    // is too small for the sending rate
+    qint64 allocations() const;
+
+private:
+    friend class QWebSocketThreadedBuffer;
+
+    mutable QMutex m_mutex;
+    QVector<QWebSocketThreadedBufferBlock *> m_free;
+    int m_maxCount;
+    QAtomicInteger<qint64> m_allocations;
+
+    static void release(QWebSocketThreadedBufferBlock *block);
+    void recycle(QWebSocketThreadedBufferBlock *block);
+};
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QWebSocketThreadedBuffer)
+
+#endif // QWEBSOCKETTHREADEDBUFFERPOOL_H
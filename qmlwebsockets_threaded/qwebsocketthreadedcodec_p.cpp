@@ -0,0 +1,554 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadedcodec_p.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <QVariantHash>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QtEndian>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QCborValue>
+#endif
+#include <cstring>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+// Nesting deeper than that is malformed, so that a hostile message can't
+// exhaust the stack, and unencodable
+static const int maxDepth = 128;
+
+// MessagePack extension type of timestamps
+static const qint8 timestampExtension = -1;
+
+class QWebSocketThreadedMessagePackReader
+{
+public:
+    explicit QWebSocketThreadedMessagePackReader(const QByteArray &data)
+        : m_data(reinterpret_cast<const uchar *>(data.constData())),
+          m_size(data.size()),
+          m_position(0)
+    {}
+
+    bool atEnd() const { return m_position == m_size; }
+
+    bool read(QVariant *value, int depth)
+    {
+        if (depth > maxDepth) {
+            return false;
+        }
+        const uchar *bytes;
+        if (!take(1, &bytes)) {
+            return false;
+        }
+        const uchar type = bytes[0];
+        if (type <= 0x7f) {
+            *value = qint64(type);
+            return true;
+        }
+        if (type >= 0xe0) {
+            *value = qint64(qint8(type));
+            return true;
+        }
+        if (type <= 0x8f) {
+            return readMap(type & 0x0f, value, depth);
+        }
+        if (type <= 0x9f) {
+            return readArray(type & 0x0f, value, depth);
+        }
+        if (type <= 0xbf) {
+            return readString(type & 0x1f, value);
+        }
+
+        quint64 length = 0;
+        switch (type) {
+        case 0xc0:
+            *value = QVariant();
+            return true;
+        case 0xc2:
+            *value = false;
+            return true;
+        case 0xc3:
+            *value = true;
+            return true;
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:
+            return readUnsigned(1 << (type - 0xc4), &length) && readBinary(length, value);
+        case 0xc7:
+        case 0xc8:
+        case 0xc9:
+            return readUnsigned(1 << (type - 0xc7), &length) && readExtension(length, value);
+        case 0xca: {
+            quint64 bits;
+            if (!readUnsigned(4, &bits)) {
+                return false;
+            }
+            const quint32 bits32 = quint32(bits);
+            float number;
+            std::memcpy(&number, &bits32, sizeof(number));
+            *value = double(number);
+            return true;
+        }
+        case 0xcb: {
+            quint64 bits;
+            if (!readUnsigned(8, &bits)) {
+                return false;
+            }
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+            *value = number;
+            return true;
+        }
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf: {
+            quint64 number;
+            if (!readUnsigned(1 << (type - 0xcc), &number)) {
+                return false;
+            }
+            *value = number > quint64(std::numeric_limits<qint64>::max())
+                    ? QVariant(number) : QVariant(qint64(number));
+            return true;
+        }
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3: {
+            const int size = 1 << (type - 0xd0);
+            quint64 number;
+            if (!readUnsigned(size, &number)) {
+                return false;
+            }
+            // Sign extension
+            const int shift = 64 - 8 * size;
+            *value = qint64(number << shift) >> shift;
+            return true;
+        }
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+        case 0xd7:
+        case 0xd8:
+            return readExtension(1 << (type - 0xd4), value);
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            return readUnsigned(1 << (type - 0xd9), &length) && readString(length, value);
+        case 0xdc:
+        case 0xdd:
+            return readUnsigned(2 << (type - 0xdc), &length) && readArray(length, value, depth);
+        case 0xde:
+        case 0xdf:
+            return readUnsigned(2 << (type - 0xde), &length) && readMap(length, value, depth);
+        default:
+            // 0xc1 is never used
+            return false;
+        }
+    }
+
+private:
+    const uchar *m_data;
+    int m_size;
+    int m_position;
+
+    bool take(quint64 length, const uchar **bytes)
+    {
+        if (length > quint64(m_size - m_position)) {
+            return false;
+        }
+        *bytes = m_data + m_position;
+        m_position += int(length);
+        return true;
+    }
+
+    bool readUnsigned(int size, quint64 *number)
+    {
+        const uchar *bytes;
+        if (!take(size, &bytes)) {
+            return false;
+        }
+        *number = 0;
+        for (int i = 0; i < size; ++i) {
+            *number = (*number << 8) | bytes[i];
+        }
+        return true;
+    }
+
+    bool readString(quint64 length, QVariant *value)
+    {
+        const uchar *bytes;
+        if (!take(length, &bytes)) {
+            return false;
+        }
+        *value = QString::fromUtf8(reinterpret_cast<const char *>(bytes), int(length));
+        return true;
+    }
+
+    bool readBinary(quint64 length, QVariant *value)
+    {
+        const uchar *bytes;
+        if (!take(length, &bytes)) {
+            return false;
+        }
+        *value = QByteArray(reinterpret_cast<const char *>(bytes), int(length));
+        return true;
+    }
+
+    // Timestamps become dates, other extensions their payload
+    bool readExtension(quint64 length, QVariant *value)
+    {
+        const uchar *type;
+        if (!take(1, &type)) {
+            return false;
+        }
+        if (qint8(type[0]) != timestampExtension) {
+            return readBinary(length, value);
+        }
+        quint64 seconds = 0;
+        quint64 nanoseconds = 0;
+        switch (length) {
+        case 4:
+            if (!readUnsigned(4, &seconds)) {
+                return false;
+            }
+            break;
+        case 8: {
+            quint64 packed;
+            if (!readUnsigned(8, &packed)) {
+                return false;
+            }
+            nanoseconds = packed >> 34;
+            seconds = packed & Q_UINT64_C(0x3ffffffff);
+            break;
+        }
+        case 12:
+            if (!readUnsigned(4, &nanoseconds) || !readUnsigned(8, &seconds)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+        *value = QDateTime::fromMSecsSinceEpoch(qint64(seconds) * 1000 + qint64(nanoseconds / 1000000),
+                                                Qt::UTC);
+        return true;
+    }
+
+    bool readArray(quint64 count, QVariant *value, int depth)
+    {
+        // Every element takes at least one byte
+        if (count > quint64(m_size - m_position)) {
+            return false;
+        }
+        QVariantList list;
+        list.reserve(int(count));
+        for (quint64 i = 0; i < count; ++i) {
+            QVariant element;
+            if (!read(&element, depth + 1)) {
+                return false;
+            }
+            list.append(element);
+        }
+        *value = list;
+        return true;
+    }
+
+    // Keys that aren't strings are converted to one
+    bool readMap(quint64 count, QVariant *value, int depth)
+    {
+        if (count > quint64(m_size - m_position) / 2) {
+            return false;
+        }
+        QVariantMap map;
+        for (quint64 i = 0; i < count; ++i) {
+            QVariant key;
+            QVariant element;
+            if (!read(&key, depth + 1) || !read(&element, depth + 1)) {
+                return false;
+            }
+            map.insert(key.toString(), element);
+        }
+        *value = map;
+        return true;
+    }
+};
+
+template <typename T>
+static void appendBigEndian(QByteArray *output, T number)
+{
+    uchar bytes[sizeof(T)];
+    qToBigEndian(number, bytes);
+    output->append(reinterpret_cast<const char *>(bytes), int(sizeof(T)));
+}
+
+// fixType is 0 for types without a fix form, type8 0 for types without an
+// 8 bit length
+static void writeMessagePackHeader(QByteArray *output, quint32 length, uchar fixType, quint32 fixMax,
+                                   uchar type8, uchar type16, uchar type32)
+{
+    if (fixType && length <= fixMax) {
+        output->append(char(fixType | length));
+    } else if (type8 && length <= 0xff) {
+        output->append(char(type8));
+        output->append(char(length));
+    } else if (length <= 0xffff) {
+        output->append(char(type16));
+        appendBigEndian(output, quint16(length));
+    } else {
+        output->append(char(type32));
+        appendBigEndian(output, length);
+    }
+}
+
+static void writeMessagePackUnsigned(QByteArray *output, quint64 number)
+{
+    if (number <= 0x7f) {
+        output->append(char(number));
+    } else if (number <= 0xff) {
+        output->append(char(0xcc));
+        output->append(char(number));
+    } else if (number <= 0xffff) {
+        output->append(char(0xcd));
+        appendBigEndian(output, quint16(number));
+    } else if (number <= 0xffffffff) {
+        output->append(char(0xce));
+        appendBigEndian(output, quint32(number));
+    } else {
+        output->append(char(0xcf));
+        appendBigEndian(output, number);
+    }
+}
+
+static void writeMessagePackSigned(QByteArray *output, qint64 number)
+{
+    if (number >= 0) {
+        writeMessagePackUnsigned(output, quint64(number));
+    } else if (number >= -32) {
+        output->append(char(number));
+    } else if (number >= std::numeric_limits<qint8>::min()) {
+        output->append(char(0xd0));
+        output->append(char(number));
+    } else if (number >= std::numeric_limits<qint16>::min()) {
+        output->append(char(0xd1));
+        appendBigEndian(output, qint16(number));
+    } else if (number >= std::numeric_limits<qint32>::min()) {
+        output->append(char(0xd2));
+        appendBigEndian(output, qint32(number));
+    } else {
+        output->append(char(0xd3));
+        appendBigEndian(output, number);
+    }
+}
+
+static void writeMessagePack(QByteArray *output, const QVariant &value, int depth);
+
+template <typename Map>
+static void writeMessagePackMap(QByteArray *output, const Map &map, int depth)
+{
+    writeMessagePackHeader(output, quint32(map.size()), 0x80, 15, 0, 0xde, 0xdf);
+    for (typename Map::const_iterator it = map.constBegin(); it != map.constEnd(); ++it) {
+        const QByteArray key = it.key().toUtf8();
+        writeMessagePackHeader(output, quint32(key.size()), 0xa0, 31, 0xd9, 0xda, 0xdb);
+        output->append(key);
+        writeMessagePack(output, it.value(), depth + 1);
+    }
+}
+
+static void writeMessagePack(QByteArray *output, const QVariant &value, int depth)
+{
+    if (depth > maxDepth) {
+        output->append(char(0xc0));
+        return;
+    }
+    switch (value.userType()) {
+    case QMetaType::Bool:
+        output->append(char(value.toBool() ? 0xc3 : 0xc2));
+        return;
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::Short:
+    case QMetaType::Int:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+        writeMessagePackSigned(output, value.toLongLong());
+        return;
+    case QMetaType::UChar:
+    case QMetaType::UShort:
+    case QMetaType::UInt:
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        writeMessagePackUnsigned(output, value.toULongLong());
+        return;
+    case QMetaType::Float: {
+        const float number = value.toFloat();
+        quint32 bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        output->append(char(0xca));
+        appendBigEndian(output, bits);
+        return;
+    }
+    case QMetaType::Double: {
+        const double number = value.toDouble();
+        quint64 bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        output->append(char(0xcb));
+        appendBigEndian(output, bits);
+        return;
+    }
+    case QMetaType::QByteArray: {
+        const QByteArray data = value.toByteArray();
+        writeMessagePackHeader(output, quint32(data.size()), 0, 0, 0xc4, 0xc5, 0xc6);
+        output->append(data);
+        return;
+    }
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList: {
+        const QVariantList list = value.toList();
+        writeMessagePackHeader(output, quint32(list.size()), 0x90, 15, 0, 0xdc, 0xdd);
+        for (const QVariant &element : list) {
+            writeMessagePack(output, element, depth + 1);
+        }
+        return;
+    }
+    case QMetaType::QVariantMap:
+        writeMessagePackMap(output, value.toMap(), depth);
+        return;
+    case QMetaType::QVariantHash:
+        writeMessagePackMap(output, value.toHash(), depth);
+        return;
+    case QMetaType::QDateTime: {
+        // The 96 bit form, which takes any date
+        const qint64 milliseconds = value.toDateTime().toMSecsSinceEpoch();
+        qint64 seconds = milliseconds / 1000;
+        qint64 remainder = milliseconds % 1000;
+        if (remainder < 0) {
+            --seconds;
+            remainder += 1000;
+        }
+        output->append(char(0xc7));
+        output->append(char(12));
+        output->append(char(timestampExtension));
+        appendBigEndian(output, quint32(remainder * 1000000));
+        appendBigEndian(output, seconds);
+        return;
+    }
+    case QMetaType::UnknownType:
+    case QMetaType::Void:
+    case QMetaType::VoidStar:
+    case QMetaType::Nullptr:
+        output->append(char(0xc0));
+        return;
+    default:
+        break;
+    }
+    if (value.canConvert<QString>()) {
+        const QByteArray text = value.toString().toUtf8();
+        writeMessagePackHeader(output, quint32(text.size()), 0xa0, 31, 0xd9, 0xda, 0xdb);
+        output->append(text);
+    } else {
+        output->append(char(0xc0));
+    }
+}
+
+bool QWebSocketThreadedCodec::isSupported(int format)
+{
+    switch (format) {
+    case Raw:
+    case MessagePack:
+        return true;
+    case Cbor:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+bool QWebSocketThreadedCodec::decode(int format, const QByteArray &data, QVariant *value)
+{
+    switch (format) {
+    case Raw:
+        *value = data;
+        return true;
+    case Cbor: {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        QCborParserError error;
+        const QCborValue cbor = QCborValue::fromCbor(data, &error);
+        if (error.error != QCborError::NoError) {
+            return false;
+        }
+        *value = cbor.toVariant();
+        return true;
+#else
+        return false;
+#endif
+    }
+    case MessagePack: {
+        QWebSocketThreadedMessagePackReader reader(data);
+        return reader.read(value, 0) && reader.atEnd();
+    }
+    }
+    return false;
+}
+
+QByteArray QWebSocketThreadedCodec::encode(int format, const QVariant &value)
+{
+    switch (format) {
+    case Raw:
+        return value.toByteArray();
+    case Cbor:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        return QCborValue::fromVariant(value).toCbor();
+#else
+        break;
+#endif
+    case MessagePack: {
+        QByteArray output;
+        writeMessagePack(&output, value, 0);
+        return output;
+    }
+    }
+    return QByteArray();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,144 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadeddeflate_p.h"
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+static const char deflateTail[] = { '\x00', '\x00', '\xff', '\xff' };
+static const int chunkSize = 16 * 1024;
+
+QWebSocketThreadedDeflate::QWebSocketThreadedDeflate(int windowBits, bool contextTakeover)
+    : m_deflateReady(false),
+      m_inflateReady(false),
+      m_contextTakeover(contextTakeover)
+{
+    windowBits = qBound(9, windowBits, 15);
+    std::memset(&m_deflate, 0, sizeof(m_deflate));
+    std::memset(&m_inflate, 0, sizeof(m_inflate));
+    // Negative window bits select raw deflate without the zlib header
+    m_deflateReady = deflateInit2(&m_deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -windowBits,
+                                  8, Z_DEFAULT_STRATEGY) == Z_OK;
+    // The peer may use any window up to the maximum
+    m_inflateReady = inflateInit2(&m_inflate, -15) == Z_OK;
+}
+
+QWebSocketThreadedDeflate::~QWebSocketThreadedDeflate()
+{
+    if (m_deflateReady) {
+        deflateEnd(&m_deflate);
+    }
+    if (m_inflateReady) {
+        inflateEnd(&m_inflate);
+    }
+}
+
+bool QWebSocketThreadedDeflate::isValid() const
+{
+    return m_deflateReady && m_inflateReady;
+}
+
+bool QWebSocketThreadedDeflate::compress(const QByteArray &data, QByteArray *result)
+{
+    result->clear();
+    if (!m_deflateReady) {
+        return false;
+    }
+    m_deflate.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    m_deflate.avail_in = uInt(data.size());
+    int status = Z_OK;
+    do {
+        const int offset = result->size();
+        result->resize(offset + chunkSize);
+        m_deflate.next_out = reinterpret_cast<Bytef *>(result->data() + offset);
+        m_deflate.avail_out = chunkSize;
+        status = deflate(&m_deflate, Z_SYNC_FLUSH);
+        result->resize(offset + chunkSize - int(m_deflate.avail_out));
+    } while (status == Z_OK && m_deflate.avail_out == 0);
+
+    // Z_BUF_ERROR only means the last round had nothing left to flush
+    if (status != Z_OK && status != Z_BUF_ERROR) {
+        // The context is lost, the next message starts from scratch
+        deflateReset(&m_deflate);
+        result->clear();
+        return false;
+    }
+    if (result->endsWith(QByteArray::fromRawData(deflateTail, sizeof(deflateTail)))) {
+        result->chop(sizeof(deflateTail));
+    }
+    if (!m_contextTakeover) {
+        deflateReset(&m_deflate);
+    }
+    return true;
+}
+
+QWebSocketThreadedDeflate::Result QWebSocketThreadedDeflate::decompress(const QByteArray &data, int maxSize,
+                                                                            QByteArray *result)
+{
+    result->clear();
+    if (!m_inflateReady) {
+        return Failed;
+    }
+    const QByteArray input = data + QByteArray::fromRawData(deflateTail, sizeof(deflateTail));
+    m_inflate.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.constData()));
+    m_inflate.avail_in = uInt(input.size());
+    int status = Z_OK;
+    do {
+        const int offset = result->size();
+        result->resize(offset + chunkSize);
+        m_inflate.next_out = reinterpret_cast<Bytef *>(result->data() + offset);
+        m_inflate.avail_out = chunkSize;
+        status = inflate(&m_inflate, Z_SYNC_FLUSH);
+        result->resize(offset + chunkSize - int(m_inflate.avail_out));
+        if (result->size() > maxSize) {
+            // Whatever is left of the message is lost with the context
+            inflateReset(&m_inflate);
+            result->clear();
+            return TooLarge;
+        }
+    } while (status == Z_OK && (m_inflate.avail_in > 0 || m_inflate.avail_out == 0));
+
+    // Z_BUF_ERROR only means there was nothing left to do
+    const bool ok = status == Z_OK || status == Z_BUF_ERROR || status == Z_STREAM_END;
+    if (!ok || !m_contextTakeover) {
+        inflateReset(&m_inflate);
+    }
+    return ok ? Ok : Failed;
+}
+
+QT_END_NAMESPACE
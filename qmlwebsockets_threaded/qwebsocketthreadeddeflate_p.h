@@ -0,0 +1,95 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDDEFLATE_P_H
+#define QWEBSOCKETTHREADEDDEFLATE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QByteArray>
+
+#include <zlib.h>
+
+QT_BEGIN_NAMESPACE
+
+// Compresses and decompresses message payloads the way RFC 7692
+// permessage-deflate does: raw DEFLATE, every message ends with a sync flush
+// whose 0x00 0x00 0xff 0xff tail is not transmitted, and without context
+// takeover both sides start every message with an empty window.
+class QWebSocketThreadedDeflate
+{
+    Q_DISABLE_COPY(QWebSocketThreadedDeflate)
+
+public:
+    // windowBits is clamped to 9..15, zlib doesn't do raw 8 bit windows
+    QWebSocketThreadedDeflate(int windowBits, bool contextTakeover);
+    ~QWebSocketThreadedDeflate();
+
+    enum Result
+    {
+        Ok,
+        Failed,
+        // More than maxSize bytes once decompressed
+        TooLarge
+    };
+
+    bool isValid() const;
+
+    // Returns false if zlib failed
+    bool compress(const QByteArray &data, QByteArray *result);
+    // Failed for corrupted input
+    Result decompress(const QByteArray &data, int maxSize, QByteArray *result);
+
+private:
+    z_stream m_deflate;
+    z_stream m_inflate;
+    bool m_deflateReady;
+    bool m_inflateReady;
+    bool m_contextTakeover;
+};
+
+QT_END_NAMESPACE
+
+#endif // QWEBSOCKETTHREADEDDEFLATE_P_H
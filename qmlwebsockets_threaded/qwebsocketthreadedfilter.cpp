@@ -0,0 +1,197 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadedfilter.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QVariantMap>
+
+QT_BEGIN_NAMESPACE
+
+// Undefined if the path doesn't exist
+static QJsonValue valueAt(const QJsonDocument &document, const QStringList &path)
+{
+    QJsonValue value = document.isArray() ? QJsonValue(document.array())
+                                          : QJsonValue(document.object());
+    for (const QString &key : path) {
+        if (value.isArray()) {
+            bool isIndex = false;
+            const int index = key.toInt(&isIndex);
+            const QJsonArray array = value.toArray();
+            value = isIndex && index >= 0 && index < array.size()
+                    ? array.at(index) : QJsonValue(QJsonValue::Undefined);
+        } else {
+            value = value.toObject().value(key);
+        }
+    }
+    return value;
+}
+
+QWebSocketThreadedMatchFilter::QWebSocketThreadedMatchFilter(const QVariantList &rules)
+    : m_wantsJson(false)
+{
+    m_rules.reserve(rules.size());
+    for (const QVariant &entry : rules) {
+        const QVariantMap map = entry.toMap();
+        Rule rule;
+        rule.prefix = map.value(QStringLiteral("prefix")).toString();
+        rule.binaryPrefix = rule.prefix.toUtf8();
+        const QString path = map.value(QStringLiteral("path")).toString();
+        if (!path.isEmpty()) {
+            rule.path = path.split(QLatin1Char('.'));
+        }
+        rule.hasValue = map.contains(QStringLiteral("value"));
+        rule.value = map.value(QStringLiteral("value"));
+        rule.increasing = map.value(QStringLiteral("increasing")).toBool();
+        rule.hasLast = false;
+        rule.last = 0;
+        rule.route = map.value(QStringLiteral("route")).toString();
+        rule.drop = map.value(QStringLiteral("drop")).toBool();
+        m_wantsJson = m_wantsJson || !rule.path.isEmpty();
+        m_rules.append(rule);
+    }
+}
+
+bool QWebSocketThreadedMatchFilter::filterTextMessage(const QString &message, QString *route)
+{
+    return filter(message, Q_NULLPTR, route);
+}
+
+bool QWebSocketThreadedMatchFilter::wantsJson() const
+{
+    return m_wantsJson;
+}
+
+bool QWebSocketThreadedMatchFilter::filterJsonMessage(const QString &message,
+                                                      const QJsonDocument &document, QString *route)
+{
+    return filter(message, &document, route);
+}
+
+bool QWebSocketThreadedMatchFilter::filter(const QString &message, const QJsonDocument *parsedDocument,
+                                           QString *route)
+{
+    // Parsed once, on the first rule that needs it
+    bool parsed = parsedDocument != Q_NULLPTR;
+    QJsonDocument document = parsed ? *parsedDocument : QJsonDocument();
+    for (Rule &rule : m_rules) {
+        if (!message.startsWith(rule.prefix)) {
+            continue;
+        }
+        if (!rule.path.isEmpty()) {
+            if (!parsed) {
+                document = QJsonDocument::fromJson(message.toUtf8());
+                parsed = true;
+            }
+            const QJsonValue value = valueAt(document, rule.path);
+            if (value.isUndefined()) {
+                continue;
+            }
+            if (rule.hasValue && value.toVariant() != rule.value) {
+                continue;
+            }
+            if (rule.increasing) {
+                if (!value.isDouble() || (rule.hasLast && value.toDouble() <= rule.last)) {
+                    continue;
+                }
+                rule.hasLast = true;
+                rule.last = value.toDouble();
+            }
+        }
+        return accept(rule, route);
+    }
+    return false;
+}
+
+bool QWebSocketThreadedMatchFilter::filterBinaryMessage(const QByteArray &message, QString *route)
+{
+    for (const Rule &rule : qAsConst(m_rules)) {
+        // Binary messages are never JSON
+        if (!rule.path.isEmpty() || !message.startsWith(rule.binaryPrefix)) {
+            continue;
+        }
+        return accept(rule, route);
+    }
+    return false;
+}
+
+bool QWebSocketThreadedMatchFilter::accept(const Rule &rule, QString *route)
+{
+    if (rule.drop) {
+        return false;
+    }
+    if (!rule.route.isEmpty()) {
+        *route = rule.route;
+    }
+    return true;
+}
+
+QWebSocketThreadedJsonKeyExtractor::QWebSocketThreadedJsonKeyExtractor(const QString &path)
+    : m_path(path.split(QLatin1Char('.')))
+{
+}
+
+QString QWebSocketThreadedJsonKeyExtractor::textMessageKey(const QString &message)
+{
+    return jsonMessageKey(message, QJsonDocument::fromJson(message.toUtf8()));
+}
+
+bool QWebSocketThreadedJsonKeyExtractor::wantsJson() const
+{
+    return true;
+}
+
+QString QWebSocketThreadedJsonKeyExtractor::jsonMessageKey(const QString &message,
+                                                           const QJsonDocument &document)
+{
+    Q_UNUSED(message)
+    const QJsonValue value = valueAt(document, m_path);
+    if (value.isUndefined() || value.isNull() || value.isArray() || value.isObject()) {
+        return QString();
+    }
+    return value.toVariant().toString();
+}
+
+QString QWebSocketThreadedJsonKeyExtractor::binaryMessageKey(const QByteArray &message)
+{
+    Q_UNUSED(message)
+    return QString();
+}
+
+QT_END_NAMESPACE
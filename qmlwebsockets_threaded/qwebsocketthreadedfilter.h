@@ -0,0 +1,166 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDFILTER_H
+#define QWEBSOCKETTHREADEDFILTER_H
+
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+// Decides on the network thread which received messages are handed to the
+// GUI thread. Once installed with QWebSocketThreaded::setFilter(), a filter
+// is only called from the network thread of that socket, so it may keep state
+// between messages but must not be used from anywhere else.
+class QWebSocketThreadedFilter
+{
+public:
+    virtual ~QWebSocketThreadedFilter() {}
+
+    // Returns false to drop the message. A route set on accepted messages
+    // delivers them as channel messages with the route as the channel, see
+    // QWebSocketThreaded::channelTextMessageReceived().
+    virtual bool filterTextMessage(const QString &message, QString *route) = 0;
+    virtual bool filterBinaryMessage(const QByteArray &message, QString *route) = 0;
+
+    // Filters that look into JSON return true, text messages are then
+    // parsed once for the filter, the key extractor and parseJson and passed
+    // to filterJsonMessage() instead, as a null document if not valid JSON.
+    virtual bool wantsJson() const { return false; }
+    virtual bool filterJsonMessage(const QString &message, const QJsonDocument &document,
+                                   QString *route)
+    {
+        Q_UNUSED(document)
+        return filterTextMessage(message, route);
+    }
+};
+
+// The filter behind WebSocket.filters: an ordered list of rules, the first
+// rule matching a message decides, messages matching no rule are dropped.
+// Every rule is a map with any of:
+//   prefix      the text message, or the binary one as UTF-8, starts with it
+//   path        dot separated path to a value of the JSON text message,
+//               numbers index arrays; the value has to exist
+//   value       the value at path equals it
+//   increasing  the value at path is a number above the last one this
+//               rule matched, to drop stale sequence numbers
+//   route       accepted messages are routed with this name
+//   drop        matching messages are dropped instead
+// An empty rule matches everything.
+class QWebSocketThreadedMatchFilter : public QWebSocketThreadedFilter
+{
+public:
+    explicit QWebSocketThreadedMatchFilter(const QVariantList &rules);
+
+    bool filterTextMessage(const QString &message, QString *route) Q_DECL_OVERRIDE;
+    bool filterBinaryMessage(const QByteArray &message, QString *route) Q_DECL_OVERRIDE;
+    bool wantsJson() const Q_DECL_OVERRIDE;
+    bool filterJsonMessage(const QString &message, const QJsonDocument &document,
+                           QString *route) Q_DECL_OVERRIDE;
+
+private:
+    struct Rule
+    {
+        QString prefix;
+        QByteArray binaryPrefix;
+        QStringList path;
+        bool hasValue;
+        QVariant value;
+        bool increasing;
+        bool hasLast;
+        double last;
+        QString route;
+        bool drop;
+    };
+
+    QVector<Rule> m_rules;
+    bool m_wantsJson;
+
+    // Parses the message on the first rule with a path unless given document
+    bool filter(const QString &message, const QJsonDocument *document, QString *route);
+    static bool accept(const Rule &rule, QString *route);
+};
+
+// Gives the key of the received messages for conflation, see
+// QWebSocketThreaded::setKeyExtractor(). Called from the network thread only,
+// like QWebSocketThreadedFilter.
+class QWebSocketThreadedKeyExtractor
+{
+public:
+    virtual ~QWebSocketThreadedKeyExtractor() {}
+
+    // A null key leaves the message out of conflation
+    virtual QString textMessageKey(const QString &message) = 0;
+    virtual QString binaryMessageKey(const QByteArray &message) = 0;
+
+    // Like QWebSocketThreadedFilter::wantsJson()
+    virtual bool wantsJson() const { return false; }
+    virtual QString jsonMessageKey(const QString &message, const QJsonDocument &document)
+    {
+        Q_UNUSED(document)
+        return textMessageKey(message);
+    }
+};
+
+// The key is the scalar value at a dot separated path of the JSON text
+// message, as in QWebSocketThreadedMatchFilter. Binary messages have no key.
+class QWebSocketThreadedJsonKeyExtractor : public QWebSocketThreadedKeyExtractor
+{
+public:
+    explicit QWebSocketThreadedJsonKeyExtractor(const QString &path);
+
+    QString textMessageKey(const QString &message) Q_DECL_OVERRIDE;
+    QString binaryMessageKey(const QByteArray &message) Q_DECL_OVERRIDE;
+    bool wantsJson() const Q_DECL_OVERRIDE;
+    QString jsonMessageKey(const QString &message, const QJsonDocument &document) Q_DECL_OVERRIDE;
+
+private:
+    QStringList m_path;
+};
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QSharedPointer<QWebSocketThreadedFilter>)
+Q_DECLARE_METATYPE(QSharedPointer<QWebSocketThreadedKeyExtractor>)
+
+#endif // QWEBSOCKETTHREADEDFILTER_H
@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadedprocessor.h"
+
+#include <QFile>
+#include <QJSEngine>
+#include <QJSValue>
+#include <QQmlEngine>
+#include <QQmlFile>
+
+QT_BEGIN_NAMESPACE
+
+class QWebSocketThreadedScript : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QWebSocketThreadedScript(const QUrl &source);
+
+    bool isValid() const { return m_onMessage.isCallable(); }
+    void process(const QVariant &message, QVariantList *output);
+
+    Q_INVOKABLE void sendMessage(const QVariant &message);
+
+private:
+    // Declared first so that it is destroyed after the values, which belong
+    // to it
+    QJSEngine m_engine;
+    QJSValue m_workerScript;
+    QJSValue m_onMessage;
+    QString m_fileName;
+    QVariantList *m_output;
+
+    void warn(const QJSValue &error) const;
+};
+
+QWebSocketThreadedScript::QWebSocketThreadedScript(const QUrl &source)
+    : QObject(),
+      m_engine(),
+      m_workerScript(),
+      m_onMessage(),
+      m_fileName(QQmlFile::urlToLocalFileOrQrc(source)),
+      m_output(Q_NULLPTR)
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("QWebSocketThreadedScriptProcessor: can't open %s", qPrintable(source.toString()));
+        return;
+    }
+    const QString program = QString::fromUtf8(file.readAll());
+
+    // The methods of a QObject wrapper stay bound to it, so sendMessage can
+    // be put on a plain object that the script is free to extend. Without a
+    // parent the wrapper would own it.
+    QQmlEngine::setObjectOwnership(this, QQmlEngine::CppOwnership);
+    const QJSValue self = m_engine.newQObject(this);
+    m_workerScript = m_engine.newObject();
+    m_workerScript.setProperty(QStringLiteral("sendMessage"), self.property(QStringLiteral("sendMessage")));
+    m_engine.globalObject().setProperty(QStringLiteral("WorkerScript"), m_workerScript);
+
+    const QJSValue result = m_engine.evaluate(program, m_fileName);
+    if (result.isError()) {
+        warn(result);
+        return;
+    }
+    m_onMessage = m_workerScript.property(QStringLiteral("onMessage"));
+    if (!m_onMessage.isCallable()) {
+        qWarning("QWebSocketThreadedScriptProcessor: %s doesn't set WorkerScript.onMessage",
+                 qPrintable(m_fileName));
+    }
+}
+
+void QWebSocketThreadedScript::process(const QVariant &message, QVariantList *output)
+{
+    m_output = output;
+    const QJSValue result = m_onMessage.call(QJSValueList() << m_engine.toScriptValue(message));
+    m_output = Q_NULLPTR;
+    if (result.isError()) {
+        warn(result);
+        return;
+    }
+    if (!result.isUndefined()) {
+        output->append(result.toVariant());
+    }
+}
+
+void QWebSocketThreadedScript::sendMessage(const QVariant &message)
+{
+    // Outside of onMessage there is nothing to deliver it with
+    if (m_output) {
+        m_output->append(message);
+    }
+}
+
+void QWebSocketThreadedScript::warn(const QJSValue &error) const
+{
+    qWarning("%s:%d: %s", qPrintable(m_fileName),
+             error.property(QStringLiteral("lineNumber")).toInt(),
+             qPrintable(error.toString()));
+}
+
+QWebSocketThreadedScriptProcessor::QWebSocketThreadedScriptProcessor(const QUrl &source)
+    : m_source(source),
+      m_script(),
+      m_loaded(false)
+{
+}
+
+QWebSocketThreadedScriptProcessor::~QWebSocketThreadedScriptProcessor()
+{
+    // The last reference may be dropped by the GUI thread, the engine has to
+    // go away in its own thread
+    if (m_script) {
+        m_script->deleteLater();
+    }
+}
+
+void QWebSocketThreadedScriptProcessor::processTextMessage(const QString &message, QVariantList *output)
+{
+    if (QWebSocketThreadedScript *script = this->script()) {
+        script->process(message, output);
+    }
+}
+
+void QWebSocketThreadedScriptProcessor::processBinaryMessage(const QByteArray &message, QVariantList *output)
+{
+    // An ArrayBuffer in the script
+    if (QWebSocketThreadedScript *script = this->script()) {
+        script->process(message, output);
+    }
+}
+
+QWebSocketThreadedScript *QWebSocketThreadedScriptProcessor::script()
+{
+    if (!m_loaded) {
+        m_loaded = true;
+        m_script = new QWebSocketThreadedScript(m_source);
+        if (!m_script->isValid()) {
+            // Messages are dropped rather than delivered unprocessed
+            delete m_script.data();
+        }
+    }
+    return m_script.data();
+}
+
+QT_END_NAMESPACE
+
+#include "qwebsocketthreadedprocessor.moc"
@@ -0,0 +1,101 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDPROCESSOR_H
+#define QWEBSOCKETTHREADEDPROCESSOR_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QUrl>
+#include <QVariant>
+
+QT_BEGIN_NAMESPACE
+
+class QWebSocketThreadedScript;
+
+// Does the work on received messages that would otherwise be done by the
+// message handlers on the GUI thread: decoding, transforming, aggregating.
+// Installed with QWebSocketThreaded::setProcessor(), it gets every whole
+// message that passed the filter and wasn't routed, on the network thread
+// only, so it may keep state between messages. Whatever it appends to output
+// is delivered with QWebSocketThreaded::processedMessageReceived(), one
+// message each, appending nothing drops the message.
+class QWebSocketThreadedProcessor
+{
+public:
+    virtual ~QWebSocketThreadedProcessor() {}
+
+    virtual void processTextMessage(const QString &message, QVariantList *output) = 0;
+    virtual void processBinaryMessage(const QByteArray &message, QVariantList *output) = 0;
+};
+
+// The processor behind WebSocket.processorSource: a JavaScript file run in
+// its own QJSEngine, created on the network thread with the first message.
+// Like in a WorkerScript, the script sets WorkerScript.onMessage to a
+// function, called with every message as a string or an ArrayBuffer, and
+// posts results with WorkerScript.sendMessage(value); returning a value
+// other than undefined from onMessage posts it as well. Only the ECMAScript
+// environment is available, not QML types.
+class QWebSocketThreadedScriptProcessor : public QWebSocketThreadedProcessor
+{
+    Q_DISABLE_COPY(QWebSocketThreadedScriptProcessor)
+
+public:
+    // A local file or a qrc URL
+    explicit QWebSocketThreadedScriptProcessor(const QUrl &source);
+    ~QWebSocketThreadedScriptProcessor();
+
+    void processTextMessage(const QString &message, QVariantList *output) Q_DECL_OVERRIDE;
+    void processBinaryMessage(const QByteArray &message, QVariantList *output) Q_DECL_OVERRIDE;
+
+private:
+    QUrl m_source;
+    // Lives in the network thread together with its engine, null until the
+    // first message or when the script failed to load
+    QPointer<QWebSocketThreadedScript> m_script;
+    bool m_loaded;
+
+    QWebSocketThreadedScript *script();
+};
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QSharedPointer<QWebSocketThreadedProcessor>)
+
+#endif // QWEBSOCKETTHREADEDPROCESSOR_H
@@ -0,0 +1,179 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDRING_P_H
+#define QWEBSOCKETTHREADEDRING_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+// Single producer, single consumer ring.
+//
+// push() and pop() don't lock or allocate as long as the ring doesn't fill
+// up. When it does, the producer spills into a mutex protected backlog which
+// the consumer takes over in one go once it emptied the ring, so the order
+// is preserved and the producer never waits for the consumer.
+//
+// The consumer is expected to sleep in its event loop between the drains:
+// push() returns true only when the consumer went idle, which is the only
+// time a wakeup has to be posted to it.
+template <typename T>
+class QWebSocketThreadedRing
+{
+    Q_DISABLE_COPY(QWebSocketThreadedRing)
+
+public:
+    enum { Capacity = 256, Mask = Capacity - 1 };
+
+    QWebSocketThreadedRing()
+        : m_head(0),
+          m_tail(0),
+          m_consumerIdle(1),
+          m_backlogged(0),
+          m_takenIndex(0)
+    {
+    }
+
+    // Producer side, returns true if the consumer has to be woken up
+    bool push(const T &value)
+    {
+        if (!m_backlogged.loadAcquire()) {
+            const quint32 tail = m_tail.load();
+            if (tail - m_head.loadAcquire() < quint32(Capacity)) {
+                m_items[tail & Mask] = value;
+                m_tail.storeRelease(tail + 1);
+                return wakeConsumer();
+            }
+        }
+        // Once backlogged, nothing goes to the ring until the consumer took
+        // the backlog over
+        QMutexLocker locker(&m_mutex);
+        m_backlog.append(value);
+        m_backlogged.storeRelease(1);
+        return wakeConsumer();
+    }
+
+    // Consumer side
+    bool pop(T *value)
+    {
+        if (popTaken(value) || popRing(value)) {
+            return true;
+        }
+        if (!m_backlogged.loadAcquire()) {
+            return false;
+        }
+        {
+            QMutexLocker locker(&m_mutex);
+            // The ring has to be re-checked after seeing the backlog, it may
+            // hold items pushed before it
+            if (m_head.load() == m_tail.loadAcquire()) {
+                m_taken.swap(m_backlog);
+                m_backlogged.storeRelease(0);
+            }
+        }
+        return popTaken(value) || popRing(value);
+    }
+
+    // Consumer side, to be called once pop() returned false. Returns false if
+    // something was pushed meanwhile and the consumer has to go on popping.
+    bool sleep()
+    {
+        m_consumerIdle.fetchAndStoreOrdered(1);
+        return m_head.load() == m_tail.loadAcquire() && !m_backlogged.loadAcquire();
+    }
+
+private:
+    T m_items[Capacity];
+    QAtomicInteger<quint32> m_head;
+    QAtomicInteger<quint32> m_tail;
+    QAtomicInt m_consumerIdle;
+    QAtomicInt m_backlogged;
+
+    QMutex m_mutex;
+    QVector<T> m_backlog;
+    QVector<T> m_taken;
+    int m_takenIndex;
+
+    bool wakeConsumer()
+    {
+        return m_consumerIdle.fetchAndStoreOrdered(0) == 1;
+    }
+
+    bool popTaken(T *value)
+    {
+        if (m_takenIndex == m_taken.size()) {
+            return false;
+        }
+        *value = m_taken.at(m_takenIndex++);
+        if (m_takenIndex == m_taken.size()) {
+            m_taken.clear();
+            m_takenIndex = 0;
+        }
+        return true;
+    }
+
+    bool popRing(T *value)
+    {
+        const quint32 head = m_head.load();
+        if (head == m_tail.loadAcquire()) {
+            return false;
+        }
+        T &item = m_items[head & Mask];
+        *value = item;
+        // don't keep the payload alive until the slot gets reused
+        item = T();
+        m_head.storeRelease(head + 1);
+        return true;
+    }
+};
+
+QT_END_NAMESPACE
+
+#endif // QWEBSOCKETTHREADEDRING_P_H
@@ -0,0 +1,164 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadedstats.h"
+#include "qwebsocketthreaded_p.h"
+
+#include <QtMath>
+
+QT_BEGIN_NAMESPACE
+
+QWebSocketThreadedStats::QWebSocketThreadedStats(const QSharedPointer<QWebSocketThreadedCounters> &counters,
+                                                 QObject *parent)
+    : QObject(parent),
+      m_counters(counters)
+{
+    connect(&m_timer, &QTimer::timeout, this, &QWebSocketThreadedStats::updated);
+}
+
+qint64 QWebSocketThreadedStats::messagesReceived() const
+{
+    return m_counters->messagesIn.load();
+}
+
+qint64 QWebSocketThreadedStats::bytesReceived() const
+{
+    return m_counters->bytesIn.load();
+}
+
+qint64 QWebSocketThreadedStats::messagesSent() const
+{
+    return m_counters->messagesOut.load();
+}
+
+qint64 QWebSocketThreadedStats::bytesSent() const
+{
+    return m_counters->bytesOut.load();
+}
+
+qint64 QWebSocketThreadedStats::messagesFiltered() const
+{
+    return m_counters->messagesFiltered.load();
+}
+
+qint64 QWebSocketThreadedStats::messagesConflated() const
+{
+    return m_counters->messagesConflated.load();
+}
+
+int QWebSocketThreadedStats::queueDepth() const
+{
+    // dispatched() may run ahead of queued() for a moment
+    return qMax(0, m_counters->queueDepth.load());
+}
+
+int QWebSocketThreadedStats::maxQueueDepth() const
+{
+    return m_counters->maxQueueDepth.load();
+}
+
+int QWebSocketThreadedStats::reconnectCount() const
+{
+    return m_counters->reconnects.load();
+}
+
+double QWebSocketThreadedStats::dispatchLatencyP50() const
+{
+    return dispatchLatencyPercentile(0.5);
+}
+
+double QWebSocketThreadedStats::dispatchLatencyP99() const
+{
+    return dispatchLatencyPercentile(0.99);
+}
+
+QVariantList QWebSocketThreadedStats::dispatchLatencyHistogram() const
+{
+    QVariantList histogram;
+    histogram.reserve(QWebSocketThreadedCounters::LatencyBuckets);
+    for (int i = 0; i < QWebSocketThreadedCounters::LatencyBuckets; ++i) {
+        histogram.append(m_counters->dispatchLatency[i].load());
+    }
+    return histogram;
+}
+
+int QWebSocketThreadedStats::updateInterval() const
+{
+    return m_timer.isActive() ? m_timer.interval() : 0;
+}
+
+void QWebSocketThreadedStats::setUpdateInterval(int updateInterval)
+{
+    updateInterval = qMax(0, updateInterval);
+    if (this->updateInterval() == updateInterval) {
+        return;
+    }
+    if (updateInterval > 0) {
+        m_timer.start(updateInterval);
+    } else {
+        m_timer.stop();
+    }
+    Q_EMIT updateIntervalChanged(updateInterval);
+}
+
+void QWebSocketThreadedStats::update()
+{
+    Q_EMIT updated();
+}
+
+double QWebSocketThreadedStats::dispatchLatencyPercentile(double percentile) const
+{
+    int counts[QWebSocketThreadedCounters::LatencyBuckets];
+    qint64 total = 0;
+    for (int i = 0; i < QWebSocketThreadedCounters::LatencyBuckets; ++i) {
+        counts[i] = m_counters->dispatchLatency[i].load();
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const qint64 rank = qMax<qint64>(1, qCeil(percentile * total));
+    qint64 seen = 0;
+    for (int i = 0; i < QWebSocketThreadedCounters::LatencyBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return double(qint64(1) << i);
+        }
+    }
+    return double(qint64(1) << (QWebSocketThreadedCounters::LatencyBuckets - 1));
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,118 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDSTATS_H
+#define QWEBSOCKETTHREADEDSTATS_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVariantList>
+
+QT_BEGIN_NAMESPACE
+
+struct QWebSocketThreadedCounters;
+
+// Read-only view of the counters of a QWebSocketThreaded. Reading doesn't
+// lock, the values are only as consistent with each other as atomics allow.
+class QWebSocketThreadedStats : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QWebSocketThreadedStats)
+
+    Q_PROPERTY(qint64 messagesReceived READ messagesReceived NOTIFY updated)
+    Q_PROPERTY(qint64 bytesReceived READ bytesReceived NOTIFY updated)
+    Q_PROPERTY(qint64 messagesSent READ messagesSent NOTIFY updated)
+    Q_PROPERTY(qint64 bytesSent READ bytesSent NOTIFY updated)
+    Q_PROPERTY(qint64 messagesFiltered READ messagesFiltered NOTIFY updated)
+    Q_PROPERTY(qint64 messagesConflated READ messagesConflated NOTIFY updated)
+    Q_PROPERTY(int queueDepth READ queueDepth NOTIFY updated)
+    Q_PROPERTY(int maxQueueDepth READ maxQueueDepth NOTIFY updated)
+    Q_PROPERTY(int reconnectCount READ reconnectCount NOTIFY updated)
+    Q_PROPERTY(double dispatchLatencyP50 READ dispatchLatencyP50 NOTIFY updated)
+    Q_PROPERTY(double dispatchLatencyP99 READ dispatchLatencyP99 NOTIFY updated)
+    Q_PROPERTY(QVariantList dispatchLatencyHistogram READ dispatchLatencyHistogram NOTIFY updated)
+    Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval NOTIFY updateIntervalChanged)
+
+public:
+    explicit QWebSocketThreadedStats(const QSharedPointer<QWebSocketThreadedCounters> &counters,
+                                     QObject *parent = Q_NULLPTR);
+
+    // Both byte counts are bytes on the wire, frame headers included, so
+    // text is counted in UTF-8. Received control frames are not seen by
+    // QWebSocketThreaded and aren't counted, written ones are.
+    qint64 messagesReceived() const;
+    qint64 bytesReceived() const;
+    qint64 messagesSent() const;
+    qint64 bytesSent() const;
+    // Messages dropped by the filter on the network thread
+    qint64 messagesFiltered() const;
+    // Messages replaced by a newer one with the same key before dispatch
+    qint64 messagesConflated() const;
+
+    // Messages handed over by the network thread and not yet dispatched on
+    // the GUI thread
+    int queueDepth() const;
+    int maxQueueDepth() const;
+    int reconnectCount() const;
+
+    // Time from the arrival on the network thread to the dispatch on the GUI
+    // thread, in microseconds. The percentiles are the upper bounds of the
+    // histogram buckets, the bucket i counts the delays below 2^i us.
+    double dispatchLatencyP50() const;
+    double dispatchLatencyP99() const;
+    QVariantList dispatchLatencyHistogram() const;
+
+    // Period of the updated() signal in milliseconds, 0 leaves it to update()
+    int updateInterval() const;
+    void setUpdateInterval(int updateInterval);
+
+    Q_INVOKABLE void update();
+
+Q_SIGNALS:
+    void updated();
+    void updateIntervalChanged(int updateInterval);
+
+private:
+    QSharedPointer<QWebSocketThreadedCounters> m_counters;
+    QTimer m_timer;
+
+    double dispatchLatencyPercentile(double percentile) const;
+};
+
+QT_END_NAMESPACE
+
+#endif // QWEBSOCKETTHREADEDSTATS_H
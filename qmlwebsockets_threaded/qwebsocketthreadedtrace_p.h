@@ -0,0 +1,69 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADEDTRACE_P_H
+#define QWEBSOCKETTHREADEDTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+// Tracepoints of qtwebsocketsthreaded.tracepoints, generated by tracegen for
+// the backend Qt was configured with, compiled out otherwise.
+//
+// Every point takes the QWebSocketThreadedCounters of the socket, shared by
+// both threads, as the socket. Received messages are identified by their
+// receivedAt timestamp, unique per socket and shared by all the outputs of a
+// processor. Outgoing messages are identified by their message id, positive
+// for posted messages and negative for sent ones.
+
+#include <QtGlobal>
+
+#if defined(QWEBSOCKETTHREADED_TRACEPOINTS)
+#include <QtCore/private/qtrace_p.h>
+#include "qtwebsocketsthreaded_tracepoints_p.h"
+#elif !defined(Q_TRACE)
+#define Q_TRACE(x, ...)
+#endif
+
+#endif // QWEBSOCKETTHREADEDTRACE_P_H
@@ -0,0 +1,328 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwebsocketthreadpool.h"
+
+#include <QStringList>
+
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(Q_OS_WIN)
+#include <qt_windows.h>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+Q_GLOBAL_STATIC(QWebSocketThreadPool, theInstance)
+
+static bool setThreadAffinity(Qt::HANDLE id, const QList<int> &cpus)
+{
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        // The kernel ignores the CPUs that don't exist
+        if (cpus.isEmpty() || cpus.contains(cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(reinterpret_cast<pthread_t>(id), sizeof(set), &set) == 0;
+#elif defined(Q_OS_WIN)
+    DWORD_PTR mask = 0;
+    if (cpus.isEmpty()) {
+        DWORD_PTR systemMask = 0;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask)) {
+            return false;
+        }
+    }
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < int(sizeof(mask) * 8)) {
+            mask |= DWORD_PTR(1) << cpu;
+        }
+    }
+    // QThread ids are thread ids, not handles, on Windows
+    HANDLE thread = OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE,
+                               DWORD(reinterpret_cast<quintptr>(id)));
+    if (!thread) {
+        return false;
+    }
+    const bool ok = SetThreadAffinityMask(thread, mask) != 0;
+    CloseHandle(thread);
+    return ok;
+#else
+    Q_UNUSED(id)
+    return cpus.isEmpty();
+#endif
+}
+
+// Reports its id to the pool before running its event loop, so that the
+// affinity can be set from any thread
+class QWebSocketThreadPoolThread : public QThread
+{
+public:
+    explicit QWebSocketThreadPoolThread(QWebSocketThreadPool *pool) : m_pool(pool) {}
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        m_pool->threadStarted(this);
+        exec();
+    }
+
+private:
+    QWebSocketThreadPool *m_pool;
+};
+
+QWebSocketThreadPool::QWebSocketThreadPool(QObject *parent)
+    : QObject(parent),
+      m_maxThreadCount(QThread::idealThreadCount()),
+      m_threadPriority(InheritPriority),
+      m_cpuAffinity()
+{
+    bool ok = false;
+    const int size = qEnvironmentVariableIntValue("QT_WEBSOCKETS_THREADED_POOL_SIZE", &ok);
+    if (ok && size > 0) {
+        m_maxThreadCount = size;
+    }
+    if (m_maxThreadCount < 1) {
+        m_maxThreadCount = 1;
+    }
+    const int priority = qEnvironmentVariableIntValue("QT_WEBSOCKETS_THREADED_PRIORITY", &ok);
+    if (ok && priority >= IdlePriority && priority <= InheritPriority) {
+        m_threadPriority = ThreadPriority(priority);
+    }
+    // A comma separated list of CPU indexes, empty parts don't parse and are
+    // skipped like any other invalid index
+    const QString affinity = qEnvironmentVariable("QT_WEBSOCKETS_THREADED_CPU_AFFINITY");
+    const QStringList cpus = affinity.split(QLatin1Char(','));
+    for (const QString &cpu : cpus) {
+        const int index = cpu.trimmed().toInt(&ok);
+        if (ok && index >= 0) {
+            m_cpuAffinity.append(index);
+        }
+    }
+}
+
+QWebSocketThreadPool::~QWebSocketThreadPool()
+{
+    // Blocks until each of them ran on its thread, a quit() right after could
+    // otherwise stop the event loop before. Their deleteLater() is flushed
+    // when the threads finish.
+    Q_EMIT threadsStopping(QPrivateSignal());
+    for (const ThreadSlot &slot : qAsConst(m_threads)) {
+        slot.thread->quit();
+    }
+    for (const ThreadSlot &slot : qAsConst(m_threads)) {
+        slot.thread->wait();
+        delete slot.thread;
+    }
+}
+
+QWebSocketThreadPool *QWebSocketThreadPool::globalInstance()
+{
+    return theInstance();
+}
+
+int QWebSocketThreadPool::maxThreadCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxThreadCount;
+}
+
+void QWebSocketThreadPool::setMaxThreadCount(int maxThreadCount)
+{
+    if (maxThreadCount < 1) {
+        maxThreadCount = 1;
+    }
+    QVector<QThread *> stopped;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_maxThreadCount == maxThreadCount) {
+            return;
+        }
+        // Threads above the new limit keep serving their sockets, they just
+        // stop receiving new ones and are stopped once they become idle, like
+        // the idle ones are right away.
+        m_maxThreadCount = maxThreadCount;
+        for (int i = m_threads.size() - 1; i >= m_maxThreadCount; --i) {
+            if (m_threads.at(i).load == 0) {
+                stopped.append(m_threads.at(i).thread);
+                m_threads.remove(i);
+            }
+        }
+    }
+    for (QThread *thread : qAsConst(stopped)) {
+        connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+        thread->quit();
+    }
+    Q_EMIT maxThreadCountChanged(maxThreadCount);
+    if (!stopped.isEmpty()) {
+        Q_EMIT activeThreadCountChanged(activeThreadCount());
+    }
+}
+
+QWebSocketThreadPool::ThreadPriority QWebSocketThreadPool::threadPriority() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_threadPriority;
+}
+
+void QWebSocketThreadPool::setThreadPriority(ThreadPriority threadPriority)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_threadPriority == threadPriority) {
+            return;
+        }
+        m_threadPriority = threadPriority;
+        // A running thread can't go back to inheriting, it keeps its priority
+        if (threadPriority != InheritPriority) {
+            for (const ThreadSlot &slot : qAsConst(m_threads)) {
+                slot.thread->setPriority(QThread::Priority(threadPriority));
+            }
+        }
+    }
+    Q_EMIT threadPriorityChanged(threadPriority);
+}
+
+QList<int> QWebSocketThreadPool::cpuAffinity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cpuAffinity;
+}
+
+void QWebSocketThreadPool::setCpuAffinity(const QList<int> &cpuAffinity)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_cpuAffinity == cpuAffinity) {
+            return;
+        }
+        m_cpuAffinity = cpuAffinity;
+        // The threads that aren't running yet set it themselves
+        for (const ThreadSlot &slot : qAsConst(m_threads)) {
+            if (slot.id && !setThreadAffinity(slot.id, m_cpuAffinity)) {
+                qWarning("QWebSocketThreadPool: can't set the CPU affinity of %s",
+                         qPrintable(slot.thread->objectName()));
+            }
+        }
+    }
+    Q_EMIT cpuAffinityChanged(cpuAffinity);
+}
+
+int QWebSocketThreadPool::activeThreadCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_threads.size();
+}
+
+QThread *QWebSocketThreadPool::acquire()
+{
+    QThread *thread = Q_NULLPTR;
+    bool started = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        int best = -1;
+        const int count = qMin(m_threads.size(), m_maxThreadCount);
+        for (int i = 0; i < count; ++i) {
+            if (best < 0 || m_threads.at(i).load < m_threads.at(best).load) {
+                best = i;
+            }
+        }
+        if ((best < 0 || m_threads.at(best).load > 0) && m_threads.size() < m_maxThreadCount) {
+            ThreadSlot slot;
+            slot.thread = new QWebSocketThreadPoolThread(this);
+            slot.thread->setObjectName(QStringLiteral("QWebSocketThreaded #%1").arg(m_threads.size()));
+            slot.id = Q_NULLPTR;
+            slot.load = 0;
+            m_threads.append(slot);
+            // Waits for m_mutex to report its id
+            slot.thread->start(QThread::Priority(m_threadPriority));
+            best = m_threads.size() - 1;
+            started = true;
+        }
+        ++m_threads[best].load;
+        thread = m_threads.at(best).thread;
+    }
+    if (started) {
+        Q_EMIT activeThreadCountChanged(activeThreadCount());
+    }
+    return thread;
+}
+
+void QWebSocketThreadPool::release(QThread *thread)
+{
+    QThread *stopped = Q_NULLPTR;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < m_threads.size(); ++i) {
+            if (m_threads.at(i).thread != thread) {
+                continue;
+            }
+            if (--m_threads[i].load == 0 && i >= m_maxThreadCount) {
+                stopped = thread;
+                m_threads.remove(i);
+            }
+            break;
+        }
+    }
+    if (stopped) {
+        // QThread flushes the pending deleteLater() calls of the released
+        // sockets when it finishes, so quitting right away is safe.
+        connect(stopped, &QThread::finished, stopped, &QObject::deleteLater);
+        stopped->quit();
+        Q_EMIT activeThreadCountChanged(activeThreadCount());
+    }
+}
+
+void QWebSocketThreadPool::threadStarted(QThread *thread)
+{
+    QMutexLocker locker(&m_mutex);
+    for (ThreadSlot &slot : m_threads) {
+        if (slot.thread != thread) {
+            continue;
+        }
+        slot.id = QThread::currentThreadId();
+        if (!m_cpuAffinity.isEmpty() && !setThreadAffinity(slot.id, m_cpuAffinity)) {
+            qWarning("QWebSocketThreadPool: can't set the CPU affinity of %s",
+                     qPrintable(thread->objectName()));
+        }
+        break;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 Nikita Skovoroda <chalkerx@gmail.com>.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWEBSOCKETTHREADPOOL_H
+#define QWEBSOCKETTHREADPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QWebSocketThreadPool : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QWebSocketThreadPool)
+
+    Q_PROPERTY(int maxThreadCount READ maxThreadCount WRITE setMaxThreadCount NOTIFY maxThreadCountChanged)
+    Q_PROPERTY(int activeThreadCount READ activeThreadCount NOTIFY activeThreadCountChanged)
+    Q_PROPERTY(ThreadPriority threadPriority READ threadPriority WRITE setThreadPriority NOTIFY threadPriorityChanged)
+    Q_PROPERTY(QList<int> cpuAffinity READ cpuAffinity WRITE setCpuAffinity NOTIFY cpuAffinityChanged)
+
+public:
+    // Same values as QThread::Priority
+    enum ThreadPriority
+    {
+        IdlePriority = QThread::IdlePriority,
+        LowestPriority = QThread::LowestPriority,
+        LowPriority = QThread::LowPriority,
+        NormalPriority = QThread::NormalPriority,
+        HighPriority = QThread::HighPriority,
+        HighestPriority = QThread::HighestPriority,
+        TimeCriticalPriority = QThread::TimeCriticalPriority,
+        InheritPriority = QThread::InheritPriority
+    };
+    Q_ENUM(ThreadPriority)
+
+    explicit QWebSocketThreadPool(QObject *parent = Q_NULLPTR);
+    virtual ~QWebSocketThreadPool();
+
+    static QWebSocketThreadPool *globalInstance();
+
+    int maxThreadCount() const;
+    void setMaxThreadCount(int maxThreadCount);
+    int activeThreadCount() const;
+    // Applied to the running threads too
+    ThreadPriority threadPriority() const;
+    void setThreadPriority(ThreadPriority threadPriority);
+    // Indexes of the CPUs the threads may run on, all of them when empty.
+    // Only supported on Linux and Windows.
+    QList<int> cpuAffinity() const;
+    void setCpuAffinity(const QList<int> &cpuAffinity);
+
+    // Returns the least loaded network thread, starting a new one while
+    // the pool is below maxThreadCount and every running thread is busy.
+    QThread *acquire();
+    void release(QThread *thread);
+
+Q_SIGNALS:
+    void maxThreadCountChanged(int maxThreadCount);
+    void activeThreadCountChanged(int activeThreadCount);
+    void threadPriorityChanged(ThreadPriority threadPriority);
+    void cpuAffinityChanged(const QList<int> &cpuAffinity);
+    // Emitted by the destructor before the threads are stopped, the workers of
+    // destroyed sockets still closing their connection abort and go away
+    void threadsStopping(QPrivateSignal);
+
+private:
+    friend class QWebSocketThreadPoolThread;
+
+    struct ThreadSlot
+    {
+        QThread *thread;
+        // Set by the thread once running, null before
+        Qt::HANDLE id;
+        int load;
+    };
+
+    mutable QMutex m_mutex;
+    QVector<ThreadSlot> m_threads;
+    int m_maxThreadCount;
+    ThreadPriority m_threadPriority;
+    QList<int> m_cpuAffinity;
+
+    void threadStarted(QThread *thread);
+};
+
+QT_END_NAMESPACE
+
+#endif // QWEBSOCKETTHREADPOOL_H